@@ -2,55 +2,90 @@
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <thread>
 
+#include "rtow/animation.hpp"
+#include "rtow/cached_render.hpp"
 #include "rtow/camera.hpp"
 #include "rtow/color.h"
+#include "rtow/environment.hpp"
+#include "rtow/frame_writer.h"
 #include "rtow/hittable.hpp"
 #include "rtow/image.h"
+#include "rtow/integrator.hpp"
+#include "rtow/light.hpp"
 #include "rtow/material.hpp"
+#include "rtow/pipeline.hpp"
 #include "rtow/pose.hpp"
-#include "rtow/sphere.hpp"
+#include "rtow/postprocess.h"
+#include "rtow/renderer.hpp"
+#include "rtow/scene_arena.hpp"
+#include "rtow/simd.h"
+#include "rtow/streaming.hpp"
+#include "rtow/temporal.hpp"
+#include "rtow/texture.h"
+#include "rtow/thread_pool.h"
+#include "rtow/tile_cache.h"
 #include "rtow/utils.hpp"
 #include "rtow/vec_utils.hpp"
+#include "rtow/wavefront.hpp"
 
 using namespace rtow;
 
-color ray_color(const Rayf& r, const HittableList<float>& world, const size_t max_bounces) {
-  HitRecord<float> record;
-  Rayf ray_out, ray_in = r;
-
-  size_t depth = max_bounces;
-  color attenuation, col = {1.F};
-  bool hit_once = false;
-
-  while (depth > 0) {
-    if (world.hit(ray_in, 0.001, 1000., record)) {
-      hit_once = true;
-      if (record.material_ptr->scatter(ray_in, record, attenuation, ray_out)) {
-        col *= attenuation;
-        ray_in = ray_out;
-        depth = depth - 1;
-      } else {
-        // light ray got absorbed
-        col = {0.F};
-        break;
+namespace {
+
+/// "checker" is a procedural checkerboard; any other path is mapped if it holds a tiled texture (see
+/// MipTexture::save) and read as a PPM otherwise.
+std::shared_ptr<const Texture> load_texture(const std::string& path) {
+  if (path == "checker") {
+    Image8 checker = {1024, 512, std::vector<uint8_t>(1024 * 512 * 3)};
+    for (size_t y = 0; y < checker.height; ++y) {
+      for (size_t x = 0; x < checker.width; ++x) {
+        const bool light = ((x / 32) + (y / 32)) % 2 == 0;
+        uint8_t* texel = checker.rgb.data() + (y * checker.width + x) * 3;
+        texel[0] = light ? 230 : 180;
+        texel[1] = light ? 220 : 40;
+        texel[2] = light ? 200 : 40;
       }
-    } else {
-      // no-hit
-      break;
     }
+    return std::make_shared<MipTexture>(checker.rgb.data(), checker.width, checker.height);
   }
+  if (auto mapped = MipTexture::open(path)) return mapped;
+  Image8 image;
+  if (!read_ppm(path, image)) return nullptr;
+  return std::make_shared<MipTexture>(image.rgb.data(), image.width, image.height);
+}
 
-  if (hit_once) {
-    return col;
+/// "sun" is a procedural clear sky with a small, very bright sun; any other path is read as a PFM.
+std::shared_ptr<EnvironmentLight<float>> load_environment(const std::string& path) {
+  Image radiance = {0, 0, PIXEL_FORMAT::UNKNOWN};
+  if (path == "sun") {
+    radiance = {1024, 512, PIXEL_FORMAT::RGB};
+    if (!radiance.alloc()) return nullptr;
+    const Vec3f sun = normalize(Vec3f{-0.4, -0.8, -0.3});
+    const auto width = static_cast<float>(radiance.width());
+    const auto height = static_cast<float>(radiance.height());
+    for (size_t v = 0; v < radiance.height(); ++v) {
+      const float theta = static_cast<float>(M_PI) * (static_cast<float>(v) + 0.5F) / height;
+      for (size_t u = 0; u < radiance.width(); ++u) {
+        const float phi =
+            2.F * static_cast<float>(M_PI) * (static_cast<float>(u) + 0.5F) / width - static_cast<float>(M_PI);
+        const Vec3f d = {std::sin(theta) * std::cos(phi), -std::cos(theta), std::sin(theta) * std::sin(phi)};
+        // blue overhead, pale at the horizon, dark ground below it
+        const float t = std::max(0.F, -d.y());
+        color c = d.y() < 0.F ? color{0.45F, 0.5F, 0.55F} * (1.F - t) + color{0.15F, 0.25F, 0.5F} * t : color(0.05F);
+        if (dot(d, sun) > 0.9995F) c = color{400.F, 360.F, 300.F};
+        radiance.at(u, v) = c;
+      }
+    }
+  } else if (!read_pfm(path, radiance)) {
+    return nullptr;
   }
-
-  // background -- no-hit
-  const Vec3f dir = normalize(r.direction());
-  const float t = (dir.y() + .5f);
-  return color(1.) * t + color(0.5f, 0.7f, 1.f) * (1.f - t);
+  return std::make_shared<EnvironmentLight<float>>(radiance);
 }
 
+}  // namespace
+
 int main(int argc, char** argv) {
   struct Profile {
     std::string name = "undefined";
@@ -76,17 +111,102 @@ int main(int argc, char** argv) {
   // clang-format on
 
   Profile selected_profile = low;
-  if (argc > 1) {
-    std::string profile = std::string(argv[1]);
-    if (profile == "--low" || profile == "-l") {
+  int64_t deadline_ms = -1;  // progressive rendering until the deadline when set
+  size_t temporal_frames = 0;  // flythrough reusing samples across frames when set
+  size_t animation_frames = 0;  // keyframed camera path rendered back-to-back when set
+  size_t band_rows = 0;  // stream the image to disk in bands of this many rows when set
+  bool pipelined = false;  // overlap rendering with post-processing, encoding and writing
+  bool numa = false;  // pin threads per NUMA node, first-touch the framebuffer and replicate the scene
+  size_t num_threads = std::thread::hardware_concurrency();
+  IntegratorType integrator = IntegratorType::PATH;
+  std::string wavefront;  // breadth-first path tracing: "sorted", "unsorted" or "compare"
+  std::string cache_directory;  // reuse unchanged tiles from earlier runs when set
+  std::string environment_path;  // lights the scene and replaces the sky: a .pfm or "sun"
+  std::string texture_path;  // albedo texture of the center sphere: a .ppm, a tiled texture file or "checker"
+  size_t ao_rays = 4;
+  PostProcessSettings display;  // exposure, tone map and encoding of the written stills
+  for (int a = 1; a < argc; ++a) {
+    const std::string arg = std::string(argv[a]);
+    const bool has_value = a + 1 < argc;
+    if (arg == "--low" || arg == "-l") {
       selected_profile = low;
-    } else if (profile == "--medium" || profile == "-m") {
+    } else if (arg == "--medium" || arg == "-m") {
       selected_profile = medium;
-    } else if (profile == "--high" || profile == "-h") {
+    } else if (arg == "--high" || arg == "-h") {
       selected_profile = high;
+    } else if ((arg == "--deadline" || arg == "-d") && has_value) {
+      deadline_ms = std::stoll(argv[++a]);
+    } else if ((arg == "--animate" || arg == "-a") && has_value) {
+      animation_frames = std::stoul(argv[++a]);
+    } else if ((arg == "--band" || arg == "-b") && has_value) {
+      band_rows = std::stoul(argv[++a]);
+    } else if (arg == "--numa") {
+      numa = true;
+    } else if (arg == "--pipeline") {
+      pipelined = true;
+    } else if (arg == "--temporal" && has_value) {
+      temporal_frames = std::stoul(argv[++a]);
+    } else if ((arg == "--preview" || arg == "-p") && has_value) {
+      const std::string mode = std::string(argv[++a]);
+      integrator = mode == "normals" ? IntegratorType::NORMALS
+                   : mode == "depth" ? IntegratorType::DEPTH
+                   : mode == "ao"    ? IntegratorType::AMBIENT_OCCLUSION
+                                     : IntegratorType::UNKNOWN;
+      if (integrator == IntegratorType::UNKNOWN) {
+        std::cerr << "Unknown preview mode: " << mode << " (expected normals, depth or ao)\n";
+        return -1;
+      }
+    } else if ((arg == "--wavefront" || arg == "-w") && has_value) {
+      wavefront = std::string(argv[++a]);
+      if (wavefront != "sorted" && wavefront != "unsorted" && wavefront != "compare") {
+        std::cerr << "Unknown wavefront mode: " << wavefront << " (expected sorted, unsorted or compare)\n";
+        return -1;
+      }
+    } else if (arg == "--env" && has_value) {
+      environment_path = argv[++a];
+    } else if (arg == "--texture" && has_value) {
+      texture_path = argv[++a];
+    } else if ((arg == "--cache" || arg == "-c") && has_value) {
+      cache_directory = std::string(argv[++a]);
+    } else if (arg == "--ao-rays" && has_value) {
+      ao_rays = std::stoul(argv[++a]);
+    } else if (arg == "--simd" && has_value) {
+      // force a kernel level for benchmarking; defaults to the best the CPU supports
+      SimdLevel level = SimdLevel::SCALAR;
+      if (!parse_simd_level(argv[++a], level)) {
+        std::cerr << "Unknown SIMD level: " << argv[a] << " (expected scalar, sse4.2, avx2 or avx512)\n";
+        return -1;
+      }
+      set_simd_level(level);
+    } else if ((arg == "--exposure" || arg == "-e") && has_value) {
+      display.exposure = std::stof(argv[++a]);
+    } else if (arg == "--tonemap" && has_value) {
+      if (!parse_tone_map(argv[++a], display.tone_map)) {
+        std::cerr << "Unknown tone map: " << argv[a] << " (expected clamp, reinhard or aces)\n";
+        return -1;
+      }
+    } else if (arg == "--srgb") {
+      display.transfer = TransferFunction::SRGB;
+    } else if ((arg == "--threads" || arg == "-t") && has_value) {
+      num_threads = std::stoul(argv[++a]);
+    } else {
+      std::cerr << "Unknown argument: " << arg << "\n"
+                << "Usage: " << argv[0] << " [--low|--medium|--high] [--deadline <ms>] [--temporal <frames>] [--animate <frames>]\n"
+                << "       [--band <rows>] [--pipeline] [--numa] [--preview normals|depth|ao] [--ao-rays <n>]\n"
+                << "       [--wavefront sorted|unsorted|compare] [--cache <dir>] [--threads <n>]\n"
+                << "       [--simd scalar|sse4.2|avx2|avx512] [--exposure <stops>] [--tonemap clamp|reinhard|aces]\n"
+                << "       [--srgb] [--texture <file.ppm|file.rtex|checker>] [--env <file.pfm|sun>]\n";
+      return -1;
     }
   }
 
+  // previews are first-hit only and need a single sample per pixel
+  const bool preview = integrator != IntegratorType::PATH;
+  if (preview) {
+    selected_profile.name.append("-preview");
+    selected_profile.samples_per_pixel = 1;
+  }
+
   std::string file_path = "part10.ppm";
   std::ostream& logging = std::cout;
 
@@ -94,7 +214,10 @@ int main(int argc, char** argv) {
                   .append("-")
                   .append(selected_profile.name)
                   .append(".ppm");
-  std::ofstream out(file_path, std::ios_base::out | std::ios_base::trunc);
+  // only the still paths write 'file_path'; --animate and --temporal write numbered frames next to it
+  const auto open_still = [&file_path] {
+    return std::ofstream(file_path, std::ios_base::out | std::ios_base::trunc);
+  };
 
   const size_t width = selected_profile.width;
   const size_t height = selected_profile.height;
@@ -103,17 +226,6 @@ int main(int argc, char** argv) {
 
   logging << "Saving to file: " << file_path << " using profile: \n" << selected_profile.string();
 
-  // image
-  Image img = {width, height, PIXEL_FORMAT::RGB};
-  if (!img.alloc()) {
-    std::cerr << "Failed to allocate image data\n";
-    return -1;
-  }
-  {
-    std::ofstream out(file_path, std::ios_base::out);
-    to_ppm(img, out);
-  }
-
   // camera
   const float fx = width / 1.;
   const float fy = width / 1.;
@@ -140,58 +252,208 @@ int main(int argc, char** argv) {
   const rtow::pose<> pose_world_camera = rtow::LookAt(cam_position, cam_at, cam_up);
   logging << "Camera world pose: " << pose_world_camera.Print() << "\n";
 
+  // scene -- primitives live in contiguous arrays owned by the arena
+  rtow::SceneArena<float> world;
+  world.reserve(6);
+
   // materials
-  auto mat_ground = std::make_shared<rtow::Lambertian<float>>(rtow::color{0.5, 0.5, 0.0});
-  auto mat_center = std::make_shared<rtow::Lambertian<float>>(rtow::color{0.7, 0.3, 0.3});
-  // auto mat_left = std::make_shared<rtow::Metal<float>>(rtow::color{0.8, 0.8, 0.8}, 1.0);
-  auto mat_left = std::make_shared<rtow::Dielectric<float>>(1.5F);
-  auto mat_right = std::make_shared<rtow::Metal<float>>(rtow::color{0.8, 0.6, 0.2}, 0.0);
+  auto mat_ground = world.add_material(std::make_shared<rtow::Lambertian<float>>(rtow::color{0.5, 0.5, 0.0}));
+  std::shared_ptr<const rtow::Texture> texture;
+  if (!texture_path.empty()) {
+    texture = load_texture(texture_path);
+    if (texture == nullptr) {
+      std::cerr << "Failed to load texture " << texture_path << "\n";
+      return -1;
+    }
+  }
+  auto mat_center = world.add_material(texture != nullptr ? std::make_shared<rtow::Lambertian<float>>(texture)
+                                                          : std::make_shared<rtow::Lambertian<float>>(rtow::color{0.7, 0.3, 0.3}));
+  // auto mat_left = world.add_material(std::make_shared<rtow::Metal<float>>(rtow::color{0.8, 0.8, 0.8}, 1.0));
+  auto mat_left = world.add_material(std::make_shared<rtow::Dielectric<float>>(1.5F));
+  auto mat_right = world.add_material(std::make_shared<rtow::Metal<float>>(rtow::color{0.8, 0.6, 0.2}, 0.0));
+  auto mat_lamp = world.add_material(std::make_shared<rtow::DiffuseLight<float>>(rtow::color{40., 36., 30.}));
 
   // objects
-  rtow::HittableList<float> world;
-  world.add(std::make_shared<rtow::Sphere<float>>(Vec3f{0., 100.5, 1.}, 100., mat_ground));
-  world.add(std::make_shared<rtow::Sphere<float>>(Vec3f{0., 0., 1.}, 0.5, mat_center));
-  world.add(std::make_shared<rtow::Sphere<float>>(Vec3f{-1., 0., 1.}, 0.5, mat_left));
-  world.add(std::make_shared<rtow::Sphere<float>>(Vec3f{-1., 0., 1.}, -0.4, mat_left));
-  world.add(std::make_shared<rtow::Sphere<float>>(Vec3f{1., 0., 1.}, 0.5, mat_right));
+  world.add_sphere(Vec3f{0., 100.5, 1.}, 100., mat_ground);
+  world.add_sphere(Vec3f{0., 0., 1.}, 0.5, mat_center);
+  world.add_sphere(Vec3f{-1., 0., 1.}, 0.5, mat_left);
+  world.add_sphere(Vec3f{-1., 0., 1.}, -0.4, mat_left);
+  world.add_sphere(Vec3f{1., 0., 1.}, 0.5, mat_right);
+
+  // lights -- a small lamp above the spheres, also sampled explicitly at every diffuse bounce
+  const auto lamp = world.add_sphere(Vec3f{0.5, -1.2, 0.4}, 0.08, mat_lamp);
+  rtow::LightList<float> lights;
+  lights.add(std::make_shared<rtow::SphereLight<float>>(world.center(lamp), world.radius(lamp), world.material(lamp)));
+  if (!environment_path.empty()) {
+    auto environment = load_environment(environment_path);
+    if (environment == nullptr) {
+      std::cerr << "Failed to load environment " << environment_path << "\n";
+      return -1;
+    }
+    lights.set_environment(environment);
+  }
+  lights.build_tree();  // pick lights by their contribution; a single lamp is sampled exactly as before
 
   // render
+  // on a single-node machine --numa falls back to the plain pool and a shared scene
+  ThreadPool pool(num_threads, numa ? NumaTopology::detect() : NumaTopology::single_node());
+  RenderSettings settings;
+  settings.samples_per_pixel = kSpp;
+  settings.max_ray_bounces = kRayBounces;
+  settings.integrator = integrator;
+  settings.ao_rays = ao_rays;
+  settings.replicate_scene = numa;
+  Renderer<float> renderer(*camera, pose_world_camera, world, lights, pool, settings);
+  logging << "Rendering on " << pool.size() << " threads, " << to_string(simd_level()) << " kernels\n";
+  if (numa) logging << "NUMA: " << pool.num_nodes() << " node(s)\n";
+
+  if (band_rows > 0) {
+    // bounded memory: only a few bands are ever resident and each is written as soon as it is done
+    std::ofstream out = open_still();
+    const StreamingStats stats = render_streaming(renderer, width, height, band_rows, kSpp, display, out);
+    logging << "Streamed " << stats.bands << " bands in " << stats.render_ms << "ms ("
+            << stats.write_ms << "ms of encoding overlapped), peak framebuffer memory "
+            << stats.peak_band_bytes / 1024 << "KiB instead of " << width * height * 2 * sizeof(color) / 1024
+            << "KiB\n";
+    return 0;
+  }
+
+  if (pipelined) {
+    // tiles go to post-processing as soon as they are done; only the drain after the last tile is not hidden
+    std::ofstream out = open_still();
+    const PipelineStats stats = render_pipelined(renderer, width, height, kSpp, display, out);
+    const auto report = [&](const char* name, const StageStats& stage) {
+      logging << "  " << name << ": " << stage.items << " items, " << stage.busy_ms << "ms busy, mean "
+              << stage.mean_ms() << "ms, max " << stage.max_ms << "ms\n";
+    };
+    logging << "Pipelined render in " << stats.wall_ms << "ms, " << stats.drain_ms() << "ms after the last tile\n";
+    report("render", stats.render);
+    report("post-process", stats.post_process);
+    report("encode", stats.encode);
+    report("write", stats.write);
+    return 0;
+  }
+
+  // image
+  Image accumulator = {width, height, PIXEL_FORMAT::RGB};
+  Image8 display_img;
+  if (!(numa ? renderer.alloc(accumulator) : accumulator.alloc())) {
+    std::cerr << "Failed to allocate image data\n";
+    return -1;
+  }
+
+  if (animation_frames > 0) {
+    // keyframed orbit around the spheres; scene, lights and threads stay up for the whole sequence and
+    // frame N is encoded and written while frame N+1 renders
+    CameraPath<float> path;
+    path.add(0.F, pose_world_camera);
+    path.add(1.F, rtow::LookAt(Vec3f{1.4, -1.3, -1.0}, Vec3f{0., 0., 1.}, cam_up));
+    path.add(2.F, rtow::LookAt(Vec3f{2.4, -1.0, 0.8}, Vec3f{0., 0., 1.}, cam_up));
+
+    FrameWriter writer(2, logging);
+    const auto sequence_start = Renderer<float>::Clock::now();
+    for (size_t frame = 0; frame < animation_frames; ++frame) {
+      renderer.set_pose(path.frame(frame, animation_frames));
+
+      const auto frame_start = Renderer<float>::Clock::now();
+      std::fill(accumulator.data(), accumulator.data() + width * height, color(0.F));
+      renderer.render_pass(accumulator, kSpp, 0, frame * kSpp);
+      post_process(accumulator, kSpp, display, display_img);
+      const auto frame_end = Renderer<float>::Clock::now();
+
+      std::string frame_path = file_path.substr(0, file_path.find_last_of('.'));
+      frame_path.append("-").append(std::to_string(frame)).append(".ppm");
+      logging << "Frame " << frame << ": " << std::chrono::duration<double, std::milli>(frame_end - frame_start).count()
+              << "ms -> " << frame_path << "\n";
+      writer.write(frame_path, Image8(display_img));
+    }
+    writer.finish();
+    const auto sequence_end = Renderer<float>::Clock::now();
+
+    logging << "Rendered " << animation_frames << " frames in "
+            << std::chrono::duration<double, std::milli>(sequence_end - sequence_start).count() << "ms; "
+            << writer.busy_ms() << "ms of encoding overlapped with rendering\n";
+    return 0;
+  }
+
+  if (temporal_frames > 0) {
+    // flythrough: the camera slides sideways while looking at the same point
+    TemporalAccumulator<float> temporal(width, height);
+    for (size_t frame = 0; frame < temporal_frames; ++frame) {
+      const Vec3f frame_position = cam_position + Vec3f{0.02F * frame, 0.F, 0.F};
+      const rtow::pose<> pose_frame = rtow::LookAt(frame_position, cam_at, cam_up);
+
+      const auto frame_start = Renderer<float>::Clock::now();
+      const float reused = temporal.render(renderer, pose_frame, accumulator);
+      const auto frame_end = Renderer<float>::Clock::now();
+
+      std::string frame_path = file_path.substr(0, file_path.find_last_of('.'));
+      frame_path.append("-").append(std::to_string(frame)).append(".ppm");
+      logging << "Frame " << frame << ": " << std::chrono::duration<double, std::milli>(frame_end - frame_start).count()
+              << "ms, history reused for " << reused * 100.F << "% of pixels -> " << frame_path << "\n";
+
+      std::ofstream frame_out(frame_path, std::ios_base::out | std::ios_base::trunc);
+      post_process(accumulator, 1, display, display_img);
+      rtow::to_ppm(display_img, frame_out);
+    }
+    return 0;
+  }
+
   const int64_t time_start = std::chrono::system_clock::now().time_since_epoch().count();
-  for (size_t i = 0; i < img.height(); ++i) {
-    for (size_t j = 0; j < img.width(); ++j) {
-      logging << "\r"
-              << "Progress: " << float(i * img.width() + j + 1) / float(img.width() * img.height()) * 100.F
-              << "% (" << j << ", " << i << ")";
-      rtow::color& col = img.at(j, i);
-      col = color(0.F);
-      for (size_t k = 0; k < kSpp; ++k) {
-        const float ej = static_cast<float>(j) + rtow::random(0.F, 1.F);
-        const float ei = static_cast<float>(i) + rtow::random(0.F, 1.F);
-        const auto ray_camera = camera->unproject({ej, ei});
-        const Rayf ray = {rtow::Transform(pose_world_camera, ray_camera.origin()),
-                          rtow::TransformDir(pose_world_camera, ray_camera.direction())};
-        const color ray_col = ray_color(ray, world, kRayBounces);
-        if (ray_col.has_NaN()) {
-          logging << "For (" << ej << ", " << ei << ") and ray sample: " << k << " we got NAN\n";
-        }
-        col += ray_col;
-      }
-      col /= kSpp;
-      // gamma correction
-      col.x() = std::pow(col.x(), 0.4);
-      col.y() = std::pow(col.y(), 0.4);
-      col.z() = std::pow(col.z(), 0.4);
+  size_t spp = 0;
+  if (!wavefront.empty()) {
+    const auto report = [&logging](const char* name, const WavefrontStats& stats) {
+      logging << name << ": " << stats.rays_per_second(0) * 1e-6 << " Mrays/s overall, "
+              << stats.rays_per_second(2) * 1e-6 << " Mrays/s at bounce >= 2 (sorting took "
+              << stats.sort_nanoseconds * 1e-6 << "ms)\n";
+    };
+
+    if (wavefront == "compare") {
+      // same frame twice; only the sorted run is kept
+      const WavefrontStats unsorted = render_pass_wavefront(renderer, accumulator, kSpp, false);
+      std::fill(accumulator.data(), accumulator.data() + width * height, color(0.F));
+      const WavefrontStats sorted = render_pass_wavefront(renderer, accumulator, kSpp, true);
+      report("unsorted", unsorted);
+      report("sorted", sorted);
+      logging << "Ray sorting gain at bounce >= 2: " << sorted.rays_per_second(2) / unsorted.rays_per_second(2)
+              << "x\n";
+    } else {
+      report(wavefront.c_str(), render_pass_wavefront(renderer, accumulator, kSpp, wavefront == "sorted"));
     }
-    {
-      std::ofstream out(file_path, std::ios_base::out);
-      rtow::to_ppm(img, out, logging);
+    spp = kSpp;
+  } else if (deadline_ms >= 0) {
+    const auto deadline = Renderer<float>::Clock::now() + std::chrono::milliseconds(deadline_ms);
+    spp = renderer.render_until(accumulator, deadline);
+  } else if (!cache_directory.empty()) {
+    TileCache cache(cache_directory);
+    render_pass_cached(renderer, cache, accumulator, kSpp);
+    spp = kSpp;
+
+    const TileCacheStats stats = cache.stats();
+    logging << "Tile cache: " << stats.hits << " hits, " << stats.misses << " misses (" << stats.hit_rate() * 100.
+            << "% hit rate), " << stats.bytes_saved / 1024 << "KiB loaded instead of rendered, "
+            << stats.bytes_written / 1024 << "KiB written\n";
+  } else {
+    for (; spp < kSpp; ++spp) {
+      logging << "\r"
+              << "Progress: " << float(spp + 1) / float(kSpp) * 100.F << "% (pass " << spp + 1 << "/" << kSpp << ")"
+              << std::flush;
+      renderer.render_pass(accumulator, 1, 0, spp);
     }
   }
   const int64_t time_end = std::chrono::system_clock::now().time_since_epoch().count();
 
   logging << "\nTook " << (time_end - time_start) * 1e-6 << "ms to complete rendering\n";
+  logging << "Samples per pixel achieved: " << spp << "\n";
+  if (texture != nullptr) {
+    const TextureCacheStats texture_stats = texture_cache_stats();
+    logging << "Texture cache: " << texture_stats.hits << " hits, " << texture_stats.misses << " misses ("
+            << texture_stats.hit_rate() * 100. << "% hit rate)\n";
+  }
 
-  // logging << "Writing image ...";
-  // rtow::to_ppm(img, out, logging);
+  logging << "Writing image ...";
+  post_process(accumulator, spp, display, display_img);
+  std::ofstream out = open_still();
+  rtow::to_ppm(display_img, out);
   logging << "completed\n";
-}
+}
\ No newline at end of file
@@ -0,0 +1,114 @@
+#include <csignal>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <pthread.h>
+#include <string>
+#include <thread>
+
+#include "rtow/light.hpp"
+#include "rtow/material.hpp"
+#include "rtow/render_server.h"
+#include "rtow/scene_arena.hpp"
+#include "rtow/thread_pool.h"
+
+using namespace rtow;
+
+// Render daemon: builds the scenes once and serves render requests until SIGINT/SIGTERM.
+//   render_server [--socket <path>] [--threads <n>]
+// Client mode sends one command to a running server and writes the reply to a file (or stdout):
+//   render_server [--socket <path>] --request "render scene=spheres width=320 height=240 spp=16" [--out <file>]
+
+namespace {
+
+// same scene as part10
+void add_spheres(RenderServer& server) {
+  auto world = std::make_shared<SceneArena<float>>();
+  auto lights = std::make_shared<LightList<float>>();
+
+  auto mat_ground = world->add_material(std::make_shared<Lambertian<float>>(color{0.5, 0.5, 0.0}));
+  auto mat_center = world->add_material(std::make_shared<Lambertian<float>>(color{0.7, 0.3, 0.3}));
+  auto mat_left = world->add_material(std::make_shared<Dielectric<float>>(1.5F));
+  auto mat_right = world->add_material(std::make_shared<Metal<float>>(color{0.8, 0.6, 0.2}, 0.0));
+  auto mat_lamp = world->add_material(std::make_shared<DiffuseLight<float>>(color{40., 36., 30.}));
+
+  world->add_sphere(Vec3f{0., 100.5, 1.}, 100., mat_ground);
+  world->add_sphere(Vec3f{0., 0., 1.}, 0.5, mat_center);
+  world->add_sphere(Vec3f{-1., 0., 1.}, 0.5, mat_left);
+  world->add_sphere(Vec3f{-1., 0., 1.}, -0.4, mat_left);
+  world->add_sphere(Vec3f{1., 0., 1.}, 0.5, mat_right);
+  const auto lamp = world->add_sphere(Vec3f{0.5, -1.2, 0.4}, 0.08, mat_lamp);
+  lights->add(std::make_shared<SphereLight<float>>(world->center(lamp), world->radius(lamp), world->material(lamp)));
+  lights->build_tree();
+
+  server.add_scene("spheres", world, lights);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string socket_path = "/tmp/rtow.sock";
+  std::string request;
+  std::string out_path;
+  size_t num_threads = std::thread::hardware_concurrency();
+
+  for (int a = 1; a < argc; ++a) {
+    const std::string arg = std::string(argv[a]);
+    const bool has_value = a + 1 < argc;
+    if ((arg == "--socket" || arg == "-s") && has_value) {
+      socket_path = argv[++a];
+    } else if ((arg == "--threads" || arg == "-t") && has_value) {
+      num_threads = std::stoul(argv[++a]);
+    } else if ((arg == "--request" || arg == "-r") && has_value) {
+      request = argv[++a];
+    } else if ((arg == "--out" || arg == "-o") && has_value) {
+      out_path = argv[++a];
+    } else {
+      std::cerr << "Unknown argument: " << arg << "\n"
+                << "Usage: " << argv[0] << " [--socket <path>] [--threads <n>]\n"
+                << "       " << argv[0] << " [--socket <path>] --request <command> [--out <file>]\n";
+      return -1;
+    }
+  }
+
+  if (!request.empty()) {
+    std::string payload;
+    std::string error;
+    if (!render_server_request(socket_path, request, payload, error)) {
+      std::cerr << "Request failed: " << error << "\n";
+      return -1;
+    }
+    if (out_path.empty()) {
+      std::cout << payload;
+    } else {
+      std::ofstream(out_path, std::ios_base::out | std::ios_base::trunc | std::ios_base::binary) << payload;
+    }
+    return 0;
+  }
+
+  // handle SIGINT/SIGTERM on a dedicated thread; every thread started from here on inherits the mask
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+  ThreadPool pool(num_threads);
+  RenderServer server(pool);
+  add_spheres(server);
+
+  std::thread signal_thread([&] {
+    int signal = 0;
+    sigwait(&signals, &signal);
+    std::cout << "Shutting down after " << server.jobs_completed() << " jobs\n";
+    server.stop();
+  });
+
+  const bool ok = server.serve(socket_path);
+  if (!ok) {
+    // nothing to wait for; wake the signal thread ourselves
+    pthread_kill(signal_thread.native_handle(), SIGTERM);
+  }
+  signal_thread.join();
+  return ok ? 0 : -1;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "rtow/ray.hpp"
+#include "rtow/rigid_transform.hpp"
+#include "rtow/vec_utils.hpp"
+
+namespace rtow {
+
+/// Axis-aligned bounding box. Default-constructed boxes are empty (min > max) and grow with expand.
+template <typename T = float>
+struct AABB {
+  Vec3<T> min = {std::numeric_limits<T>::infinity()};
+  Vec3<T> max = {-std::numeric_limits<T>::infinity()};
+
+  /// Bounds of a sphere, padded by the rounding error of the corners.
+  static AABB sphere(const Vec3<T>& center, const T radius) {
+    AABB box;
+    for (size_t a = 0; a < 3; ++a) {
+      const T extent = std::abs(radius) + T(4) * std::numeric_limits<T>::epsilon() * (std::abs(center[a]) + std::abs(radius));
+      box.min[a] = center[a] - extent;
+      box.max[a] = center[a] + extent;
+    }
+    return box;
+  }
+
+  bool empty() const { return min[0] > max[0] || min[1] > max[1] || min[2] > max[2]; }
+
+  void expand(const Vec3<T>& p) {
+    for (size_t a = 0; a < 3; ++a) {
+      min[a] = std::min(min[a], p[a]);
+      max[a] = std::max(max[a], p[a]);
+    }
+  }
+
+  void expand(const AABB& box) {
+    for (size_t a = 0; a < 3; ++a) {
+      min[a] = std::min(min[a], box.min[a]);
+      max[a] = std::max(max[a], box.max[a]);
+    }
+  }
+
+  Vec3<T> center() const { return (min + max) * T(0.5); }
+
+  /// Zero for empty boxes.
+  T surface_area() const {
+    if (empty()) return T(0);
+    const Vec3<T> d = max - min;
+    return T(2) * (d[0] * d[1] + d[1] * d[2] + d[2] * d[0]);
+  }
+
+  size_t longest_axis() const {
+    const Vec3<T> d = max - min;
+    return d[0] > d[1] ? (d[0] > d[2] ? 0 : 2) : (d[1] > d[2] ? 1 : 2);
+  }
+
+  /// Bounds of this box after a rigid transform (Arvo's method: exact bounds of the rotated box).
+  AABB transformed(const RigidTransform<T>& transform) const {
+    if (empty()) return *this;
+    const Mat3<T>& R = transform.rotation();
+    const Vec3<T>& t = transform.translation();
+    AABB out = {t, t};
+    for (size_t i = 0; i < 3; ++i) {
+      for (size_t j = 0; j < 3; ++j) {
+        const T a = R(i, j) * min[j];
+        const T b = R(i, j) * max[j];
+        out.min[i] += std::min(a, b);
+        out.max[i] += std::max(a, b);
+      }
+    }
+    return out;
+  }
+
+  /// Slab test. 'inv_direction' is 1 / ray.direction() per axis (infinities are fine). Returns the entry
+  /// distance in 't_enter' if the ray overlaps the box within [t_min, t_max].
+  bool hit(const Vec3<T>& origin, const Vec3<T>& inv_direction, const T t_min, const T t_max, T& t_enter) const {
+    T t0 = t_min;
+    T t1 = t_max;
+    for (size_t a = 0; a < 3; ++a) {
+      T near = (min[a] - origin[a]) * inv_direction[a];
+      T far = (max[a] - origin[a]) * inv_direction[a];
+      if (near > far) std::swap(near, far);
+      // widened by the rounding error of the two operations, so grazing hits are never culled
+      far *= T(1) + T(3) * std::numeric_limits<T>::epsilon();
+      // written so that NaNs (0 * inf on a slab face) leave the interval unchanged
+      t0 = near > t0 ? near : t0;
+      t1 = far < t1 ? far : t1;
+      if (t0 > t1) return false;
+    }
+    t_enter = t0;
+    return true;
+  }
+};
+
+}  // namespace rtow
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace rtow {
+
+/// Walker's alias method: draws index i with probability weights[i] / sum(weights) in constant time,
+/// from two uniform numbers, however many indices there are. Built in linear time (Vose's variant).
+class AliasTable {
+public:
+  AliasTable() = default;
+
+  /// Negative and non-finite weights count as zero. If all weights are zero the table is empty.
+  explicit AliasTable(const std::vector<double>& weights);
+
+  bool empty() const { return probability_.empty(); }
+  size_t size() const { return probability_.size(); }
+
+  /// Index for uniform numbers 'u1' (picks a column) and 'u2' (picks its own index or its alias), both
+  /// in [0, 1).
+  size_t sample(double u1, double u2) const;
+
+  /// Probability that sample() returns 'i'.
+  double probability(size_t i) const { return probability_[i]; }
+
+private:
+  std::vector<double> probability_;  // normalized weights
+  std::vector<double> threshold_;    // keep the column's own index if u2 < threshold
+  std::vector<uint32_t> alias_;
+};
+
+}  // namespace rtow
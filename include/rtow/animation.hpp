@@ -0,0 +1,62 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "rtow/pose.hpp"
+#include "rtow/quaternion.hpp"
+
+namespace rtow {
+
+template <typename T = float>
+struct Keyframe {
+  T time = T(0);
+  pose<T> pose_world_camera = InvalidPose<T>();
+  QuatTransform<T> T_world_camera;  // same pose, converted once when the keyframe is added
+};
+
+/// Camera path through keyframed poses. In between two keyframes the rotation is slerped and the
+/// position interpolated linearly, so the camera turns at a constant rate about a single axis.
+template <typename T = float>
+class CameraPath {
+public:
+  CameraPath() = default;
+
+  /// Keyframes may be added in any order.
+  void add(const T time, const pose<T>& pose_world_camera) {
+    const Keyframe<T> keyframe = {time, pose_world_camera, QuatTransform<T>(pose_world_camera)};
+    const auto it = std::upper_bound(keyframes_.begin(), keyframes_.end(), keyframe,
+                                     [](const Keyframe<T>& a, const Keyframe<T>& b) { return a.time < b.time; });
+    keyframes_.insert(it, keyframe);
+  }
+
+  bool empty() const { return keyframes_.empty(); }
+  T start() const { return keyframes_.empty() ? T(0) : keyframes_.front().time; }
+  T end() const { return keyframes_.empty() ? T(0) : keyframes_.back().time; }
+
+  /// Pose at 'time'; clamped to the first/last keyframe outside the path.
+  pose<T> at(const T time) const {
+    if (keyframes_.empty()) return InvalidPose<T>();
+    if (time <= keyframes_.front().time) return keyframes_.front().pose_world_camera;
+    if (time >= keyframes_.back().time) return keyframes_.back().pose_world_camera;
+
+    size_t i = 1;
+    while (keyframes_[i].time < time) ++i;
+    const Keyframe<T>& a = keyframes_[i - 1];
+    const Keyframe<T>& b = keyframes_[i];
+
+    const T s = (time - a.time) / (b.time - a.time);
+    return interpolate(a.T_world_camera, b.T_world_camera, s).to_pose();
+  }
+
+  /// Pose of frame 'frame' out of 'num_frames' spread evenly over the path, both ends included.
+  pose<T> frame(const size_t frame, const size_t num_frames) const {
+    const T s = num_frames > 1 ? static_cast<T>(frame) / static_cast<T>(num_frames - 1) : T(0);
+    return at(start() + s * (end() - start()));
+  }
+
+private:
+  std::vector<Keyframe<T>> keyframes_;
+};
+
+}  // namespace rtow
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace rtow {
+
+/// Multi-producer/multi-consumer FIFO of fixed capacity. Producers block while it is full, which pushes
+/// back on whatever stage feeds it.
+template <typename T>
+class BoundedQueue {
+public:
+  explicit BoundedQueue(const size_t capacity)
+      : capacity_(capacity > 0 ? capacity : 1) {}
+
+  /// Blocks until there is room. Returns false if the queue was closed.
+  bool push(T&& item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_full_.wait(lock, [this] { return closed_ || items_.size() < capacity_; });
+    if (closed_) return false;
+
+    items_.push_back(std::move(item));
+    not_empty_.notify_one();
+    return true;
+  }
+
+  /// Blocks until an item is available. Returns false once the queue is closed and drained.
+  bool pop(T& item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+    if (items_.empty()) return false;
+
+    item = std::move(items_.front());
+    items_.pop_front();
+    not_full_.notify_one();
+    return true;
+  }
+
+  /// Wakes everyone up; pending items can still be popped but nothing more can be pushed.
+  void close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    not_empty_.notify_all();
+    not_full_.notify_all();
+  }
+
+  size_t capacity() const { return capacity_; }
+
+private:
+  const size_t capacity_;
+  std::deque<T> items_;
+  std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+  bool closed_ = false;
+};
+
+}  // namespace rtow
@@ -0,0 +1,483 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+#include "rtow/aabb.hpp"
+#include "rtow/hittable.hpp"
+#include "rtow/pose.hpp"
+#include "rtow/rigid_transform.hpp"
+#include "rtow/scene_arena.hpp"
+#include "rtow/utils.hpp"
+
+namespace rtow {
+
+/// Bounding volume hierarchy over primitives given only by their boxes, built with binned SAH. Nodes
+/// live in one array with siblings next to each other. Besides building from scratch, the tree can be
+/// refit: new boxes for a few primitives are propagated up to the root along their leaves' ancestors,
+/// which keeps the topology and costs O(changed * depth).
+template <typename T = float>
+class Bvh {
+public:
+  struct Node {
+    AABB<T> bounds;
+    uint32_t first = 0;  // leaves: first entry in order(); inner nodes: left child, the right one follows
+    uint32_t count = 0;  // primitives in a leaf, 0 for inner nodes
+  };
+
+  static constexpr size_t kMaxLeafSize = 4;
+  static constexpr size_t kMaxDepth = 48;  // bounds the traversal stack
+
+  void build(const std::vector<AABB<T>>& bounds) {
+    const size_t n = bounds.size();
+    nodes_.clear();
+    parent_.clear();
+    order_.resize(n);
+    std::iota(order_.begin(), order_.end(), 0U);
+    leaf_of_.assign(n, 0U);
+    if (n == 0) {
+      cost_ = T(0);
+      return;
+    }
+
+    std::vector<Vec3<T>> centroids(n);
+    for (size_t i = 0; i < n; ++i) centroids[i] = bounds[i].center();
+
+    nodes_.reserve(2 * n);
+    parent_.reserve(2 * n);
+    nodes_.push_back({{}, 0U, static_cast<uint32_t>(n)});
+    parent_.push_back(UINT32_MAX);
+
+    struct Task {
+      uint32_t node;
+      size_t depth;
+    };
+    std::vector<Task> tasks = {{0U, 0U}};
+    while (!tasks.empty()) {
+      const Task task = tasks.back();
+      tasks.pop_back();
+
+      const uint32_t first = nodes_[task.node].first;
+      const uint32_t count = nodes_[task.node].count;
+      AABB<T> box;
+      AABB<T> centroid_box;
+      for (uint32_t i = first; i < first + count; ++i) {
+        box.expand(bounds[order_[i]]);
+        centroid_box.expand(centroids[order_[i]]);
+      }
+      nodes_[task.node].bounds = box;
+
+      uint32_t middle = first;
+      if (count <= kMaxLeafSize || task.depth >= kMaxDepth || !split(bounds, centroids, box, centroid_box, first,
+                                                                      count, middle)) {
+        for (uint32_t i = first; i < first + count; ++i) leaf_of_[order_[i]] = task.node;
+        continue;
+      }
+
+      const uint32_t left = static_cast<uint32_t>(nodes_.size());
+      nodes_.push_back({{}, first, middle - first});
+      nodes_.push_back({{}, middle, first + count - middle});
+      parent_.push_back(task.node);
+      parent_.push_back(task.node);
+      nodes_[task.node].first = left;
+      nodes_[task.node].count = 0;
+      tasks.push_back({left, task.depth + 1});
+      tasks.push_back({left + 1, task.depth + 1});
+    }
+
+    cost_ = T(0);
+    for (const Node& node : nodes_) cost_ += node.bounds.surface_area();
+    build_cost_ = cost_;
+  }
+
+  /// Propagates new boxes of the primitives in 'changed' to the root. Returns the number of nodes updated.
+  size_t refit(const std::vector<AABB<T>>& bounds, const std::vector<uint32_t>& changed) {
+    size_t updated = 0;
+    for (const uint32_t primitive : changed) {
+      uint32_t index = leaf_of_[primitive];
+      Node& leaf = nodes_[index];
+      AABB<T> box;
+      for (uint32_t i = leaf.first; i < leaf.first + leaf.count; ++i) box.expand(bounds[order_[i]]);
+      set_bounds(index, box);
+      ++updated;
+
+      while (parent_[index] != UINT32_MAX) {
+        index = parent_[index];
+        AABB<T> merged = nodes_[nodes_[index].first].bounds;
+        merged.expand(nodes_[nodes_[index].first + 1].bounds);
+        set_bounds(index, merged);
+        ++updated;
+      }
+    }
+    return updated;
+  }
+
+  /// Sum of the node surface areas, proportional to the expected traversal cost, now and right after the
+  /// last build. Refitting moving primitives makes the first grow; rebuild when it has grown too much.
+  T cost() const { return cost_; }
+  T build_cost() const { return build_cost_; }
+
+  /// Closest-hit traversal, near child first. Calls hit_primitive(index, t_min, t_max) for the primitives
+  /// in every leaf the ray reaches within [t_min, t_max]; it returns true on a hit and then lowers t_max
+  /// to the hit distance, which prunes the rest of the traversal.
+  template <typename Fn>
+  bool closest(const Ray<T>& ray, const T t_min, T& t_max, Fn&& hit_primitive) const {
+    if (nodes_.empty()) return false;
+    const Vec3<T> inv_direction = inverse_direction(ray);
+
+    struct Entry {
+      uint32_t node;
+      T t_enter;
+    };
+    Entry stack[2 * kMaxDepth + 2];
+    size_t top = 0;
+    T t_enter = T(0);
+    if (!nodes_[0].bounds.hit(ray.origin(), inv_direction, t_min, t_max, t_enter)) return false;
+    stack[top++] = {0U, t_enter};
+
+    bool hit = false;
+    while (top > 0) {
+      const Entry entry = stack[--top];
+      if (entry.t_enter > t_max) continue;
+      const Node& node = nodes_[entry.node];
+
+      if (node.count > 0) {
+        for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+          hit |= hit_primitive(order_[i], t_min, t_max);
+        }
+        continue;
+      }
+
+      T t_left = T(0);
+      T t_right = T(0);
+      const bool left = nodes_[node.first].bounds.hit(ray.origin(), inv_direction, t_min, t_max, t_left);
+      const bool right = nodes_[node.first + 1].bounds.hit(ray.origin(), inv_direction, t_min, t_max, t_right);
+      // the nearer child goes on top
+      if (left && right && t_left <= t_right) {
+        stack[top++] = {node.first + 1, t_right};
+        stack[top++] = {node.first, t_left};
+      } else if (left && right) {
+        stack[top++] = {node.first, t_left};
+        stack[top++] = {node.first + 1, t_right};
+      } else if (left) {
+        stack[top++] = {node.first, t_left};
+      } else if (right) {
+        stack[top++] = {node.first + 1, t_right};
+      }
+    }
+    return hit;
+  }
+
+  /// Any-hit traversal: stops as soon as occludes(index, t_min, t_max) returns true.
+  template <typename Fn>
+  bool any(const Ray<T>& ray, const T t_min, const T t_max, Fn&& occludes) const {
+    if (nodes_.empty()) return false;
+    const Vec3<T> inv_direction = inverse_direction(ray);
+
+    uint32_t stack[kMaxDepth + 2];
+    size_t top = 0;
+    stack[top++] = 0U;
+    T t_enter = T(0);
+    while (top > 0) {
+      const Node& node = nodes_[stack[--top]];
+      if (!node.bounds.hit(ray.origin(), inv_direction, t_min, t_max, t_enter)) continue;
+
+      if (node.count > 0) {
+        for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+          if (occludes(order_[i], t_min, t_max)) return true;
+        }
+        continue;
+      }
+      stack[top++] = node.first + 1;
+      stack[top++] = node.first;
+    }
+    return false;
+  }
+
+  const std::vector<Node>& nodes() const { return nodes_; }
+  const std::vector<uint32_t>& order() const { return order_; }
+  const AABB<T>& bounds() const { return nodes_.front().bounds; }
+  bool empty() const { return nodes_.empty(); }
+
+private:
+  static Vec3<T> inverse_direction(const Ray<T>& ray) {
+    const Vec3<T>& d = ray.direction();
+    return {T(1) / d[0], T(1) / d[1], T(1) / d[2]};
+  }
+
+  void set_bounds(const uint32_t index, const AABB<T>& box) {
+    cost_ += box.surface_area() - nodes_[index].bounds.surface_area();
+    nodes_[index].bounds = box;
+  }
+
+  // Binned SAH over the longest centroid axis. Partitions order_[first, first + count) and returns the
+  // start of the right half in 'middle'; false if keeping a leaf is cheaper.
+  bool split(const std::vector<AABB<T>>& bounds, const std::vector<Vec3<T>>& centroids, const AABB<T>& box,
+             const AABB<T>& centroid_box, const uint32_t first, const uint32_t count, uint32_t& middle) {
+    constexpr size_t kBins = 16;
+    const size_t axis = centroid_box.longest_axis();
+    const T lo = centroid_box.min[axis];
+    const T extent = centroid_box.max[axis] - lo;
+    if (!(extent > T(0))) {
+      // all centroids coincide: split in the middle to keep leaves small
+      middle = first + count / 2;
+      return true;
+    }
+
+    const auto bin_of = [&](const uint32_t primitive) {
+      const T x = (centroids[primitive][axis] - lo) / extent * T(kBins);
+      return std::min(static_cast<size_t>(x), kBins - 1);
+    };
+
+    AABB<T> bin_bounds[kBins];
+    size_t bin_count[kBins] = {};
+    for (uint32_t i = first; i < first + count; ++i) {
+      const size_t b = bin_of(order_[i]);
+      bin_bounds[b].expand(bounds[order_[i]]);
+      ++bin_count[b];
+    }
+
+    // cost of splitting after bin b, from a sweep in each direction
+    T right_area[kBins] = {};
+    size_t right_count[kBins] = {};
+    AABB<T> sweep;
+    size_t sweep_count = 0;
+    for (size_t b = kBins - 1; b > 0; --b) {
+      sweep.expand(bin_bounds[b]);
+      sweep_count += bin_count[b];
+      right_area[b - 1] = sweep.surface_area();
+      right_count[b - 1] = sweep_count;
+    }
+
+    T best_cost = std::numeric_limits<T>::infinity();
+    size_t best_bin = 0;
+    sweep = AABB<T>();
+    sweep_count = 0;
+    for (size_t b = 0; b + 1 < kBins; ++b) {
+      sweep.expand(bin_bounds[b]);
+      sweep_count += bin_count[b];
+      if (sweep_count == 0 || right_count[b] == 0) continue;
+      const T cost = sweep.surface_area() * static_cast<T>(sweep_count) + right_area[b] * static_cast<T>(right_count[b]);
+      if (cost < best_cost) {
+        best_cost = cost;
+        best_bin = b;
+      }
+    }
+
+    // traversal step counted as one intersection; leaves that are still large are split regardless
+    const T leaf_cost = static_cast<T>(count);
+    const T split_cost = T(1) + best_cost / std::max(box.surface_area(), std::numeric_limits<T>::min());
+    if (split_cost >= leaf_cost && count <= 2 * kMaxLeafSize) return false;
+
+    const auto it = std::partition(order_.begin() + first, order_.begin() + first + count,
+                                   [&](const uint32_t primitive) { return bin_of(primitive) <= best_bin; });
+    middle = static_cast<uint32_t>(it - order_.begin());
+    if (middle == first || middle == first + count) middle = first + count / 2;
+    return true;
+  }
+
+  std::vector<Node> nodes_;
+  std::vector<uint32_t> parent_;   // per node, UINT32_MAX for the root
+  std::vector<uint32_t> order_;    // primitive indices, leaves reference ranges of it
+  std::vector<uint32_t> leaf_of_;  // per primitive
+  T cost_ = T(0);
+  T build_cost_ = T(0);
+};
+
+/// Bottom level of a two-level scene: a static object (spheres in a SceneArena, in object coordinates)
+/// with a BVH that is built once.
+template <typename T = float>
+class BottomLevelBvh : public Hittable<T> {
+public:
+  explicit BottomLevelBvh(std::shared_ptr<const SceneArena<T>> geometry)
+      : geometry_(std::move(geometry)) {
+    std::vector<AABB<T>> bounds(geometry_->size());
+    for (size_t i = 0; i < bounds.size(); ++i) bounds[i] = geometry_->bounds({static_cast<uint32_t>(i)});
+    bvh_.build(bounds);
+  }
+
+  bool intersect(const Ray<T>& ray, const T t_min, const T t_max, PrimitiveHit<T>& hit) const override {
+    T closest = std::min(t_max, hit.t);
+    uint32_t best = UINT32_MAX;
+    bvh_.closest(ray, t_min, closest, [&](const uint32_t i, const T lo, T& hi) {
+      T t = T(0);
+      if (!geometry_->hit_sphere({i}, ray, lo, hi, t)) return false;
+      // equal distances go to the higher index, like SceneArena::intersect
+      if (t == hi && best != UINT32_MAX && i < best) return false;
+      hi = t;
+      best = i;
+      return true;
+    });
+    if (best == UINT32_MAX || !(closest < hit.t)) return false;
+
+    hit.t = closest;
+    hit.primitive = best;
+    hit.object = this;
+    return true;
+  }
+
+  void finalize_hit(const Ray<T>& ray, const PrimitiveHit<T>& hit, HitRecord<T>& record) const override {
+    geometry_->fill_record({hit.primitive}, ray, hit.t, record);
+  }
+
+  bool occluded(const Ray<T>& ray, const T t_min, const T t_max) const override {
+    return bvh_.any(ray, t_min, t_max, [&](const uint32_t i, const T lo, const T hi) {
+      T t = T(0);
+      return geometry_->hit_sphere({i}, ray, lo, hi, t);
+    });
+  }
+
+  uint64_t fingerprint(const BoundsFilter<T>& filter = {}) const override { return geometry_->fingerprint(filter); }
+
+  /// Object-space bounds.
+  AABB<T> bounds() const { return bvh_.empty() ? AABB<T>() : bvh_.bounds(); }
+
+  const SceneArena<T>& geometry() const { return *geometry_; }
+
+private:
+  std::shared_ptr<const SceneArena<T>> geometry_;
+  Bvh<T> bvh_;
+};
+
+struct InstanceHandle {
+  uint32_t index = UINT32_MAX;
+};
+
+struct TopLevelUpdate {
+  size_t moved = 0;         // instances whose pose changed since the last update
+  size_t nodes_refit = 0;   // work done by the refit; 0 after a rebuild
+  bool rebuilt = false;
+};
+
+/// Top level of a two-level scene: posed instances of bottom-level objects under a small BVH over their
+/// world bounds. Objects are shared between instances and never rebuilt. Moving an instance only marks
+/// it; update() then refits the top-level nodes above the moved instances, so the cost of a frame is
+/// proportional to what moved. The tree is rebuilt when instances were added, or when refitting has
+/// doubled its cost estimate. Call update() after changing poses and before rendering.
+template <typename T = float>
+class TopLevelBvh : public Hittable<T> {
+public:
+  static constexpr T kRebuildRatio = T(2);
+
+  InstanceHandle add(const std::shared_ptr<const BottomLevelBvh<T>>& object, const pose<T>& pose_world_object) {
+    instances_.push_back({object, RigidTransform<T>(pose_world_object), {}});
+    Instance& instance = instances_.back();
+    instance.T_object_world = instance.T_world_object.inverse();
+    bounds_.push_back(object->bounds().transformed(instance.T_world_object));
+    needs_build_ = true;
+    return {static_cast<uint32_t>(instances_.size() - 1)};
+  }
+
+  void set_pose(const InstanceHandle h, const pose<T>& pose_world_object) {
+    set_transform(h, RigidTransform<T>(pose_world_object));
+  }
+
+  void set_transform(const InstanceHandle h, const RigidTransform<T>& T_world_object) {
+    Instance& instance = instances_[h.index];
+    instance.T_world_object = T_world_object;
+    instance.T_object_world = T_world_object.inverse();
+    bounds_[h.index] = instance.object->bounds().transformed(T_world_object);
+    moved_.push_back(h.index);
+  }
+
+  TopLevelUpdate update() {
+    TopLevelUpdate result;
+    std::sort(moved_.begin(), moved_.end());
+    moved_.erase(std::unique(moved_.begin(), moved_.end()), moved_.end());
+    result.moved = moved_.size();
+
+    if (!needs_build_ && !moved_.empty()) {
+      result.nodes_refit = bvh_.refit(bounds_, moved_);
+      needs_build_ = bvh_.cost() > kRebuildRatio * bvh_.build_cost();
+    }
+    if (needs_build_) {
+      bvh_.build(bounds_);
+      result.nodes_refit = 0;
+      result.rebuilt = true;
+      needs_build_ = false;
+    }
+    moved_.clear();
+    return result;
+  }
+
+  bool intersect(const Ray<T>& ray, const T t_min, const T t_max, PrimitiveHit<T>& hit) const override {
+    T closest = std::min(t_max, hit.t);
+    PrimitiveHit<T> object_hit;
+    object_hit.t = hit.t;
+    uint32_t best = UINT32_MAX;
+    bvh_.closest(ray, t_min, closest, [&](const uint32_t i, const T lo, T& hi) {
+      // rigid transforms preserve lengths, so distances along the ray are the same in both frames
+      const Instance& instance = instances_[i];
+      if (!instance.object->intersect(object_ray(instance, ray), lo, hi, object_hit)) return false;
+      hi = object_hit.t;
+      best = i;
+      return true;
+    });
+    if (best == UINT32_MAX) return false;
+
+    hit.t = object_hit.t;
+    hit.primitive = object_hit.primitive;
+    hit.instance = best;
+    hit.object = this;
+    return true;
+  }
+
+  void finalize_hit(const Ray<T>& ray, const PrimitiveHit<T>& hit, HitRecord<T>& record) const override {
+    const Instance& instance = instances_[hit.instance];
+    PrimitiveHit<T> object_hit = hit;
+    object_hit.object = instance.object.get();
+    instance.object->finalize_hit(object_ray(instance, ray), object_hit, record);
+
+    // back to world coordinates; the normal keeps facing against the ray
+    record.p = ray.at(record.t);
+    record.n = instance.T_world_object.transform_dir(record.n);
+  }
+
+  bool occluded(const Ray<T>& ray, const T t_min, const T t_max) const override {
+    return bvh_.any(ray, t_min, t_max, [&](const uint32_t i, const T lo, const T hi) {
+      return instances_[i].object->occluded(object_ray(instances_[i], ray), lo, hi);
+    });
+  }
+
+  uint64_t fingerprint(const BoundsFilter<T>& filter = {}) const override {
+    uint64_t hash = instances_.size();
+    for (size_t i = 0; i < instances_.size(); ++i) {
+      const Vec3<T> center = bounds_[i].center();
+      const T radius = (bounds_[i].max - center).norm();
+      if (filter && !filter(center, radius)) {
+        hash = hash_combine(hash, 0U);
+        continue;
+      }
+      const RigidTransform<T>& transform = instances_[i].T_world_object;
+      hash = hash_combine_value(hash_combine_value(hash, transform.rotation()), transform.translation());
+      hash = hash_combine(hash, instances_[i].object->fingerprint());
+    }
+    return hash;
+  }
+
+  size_t size() const { return instances_.size(); }
+  const Bvh<T>& bvh() const { return bvh_; }
+
+private:
+  struct Instance {
+    std::shared_ptr<const BottomLevelBvh<T>> object;
+    RigidTransform<T> T_world_object;
+    RigidTransform<T> T_object_world;
+  };
+
+  static Ray<T> object_ray(const Instance& instance, const Ray<T>& ray) {
+    return {instance.T_object_world.transform_point(ray.origin()), instance.T_object_world.transform_dir(ray.direction()),
+            ray.width(), ray.spread()};
+  }
+
+  std::vector<Instance> instances_;
+  std::vector<AABB<T>> bounds_;  // world bounds per instance
+  std::vector<uint32_t> moved_;
+  Bvh<T> bvh_;
+  bool needs_build_ = true;
+};
+
+}  // namespace rtow
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+
+#include "rtow/image.h"
+#include "rtow/renderer.hpp"
+#include "rtow/tile_cache.h"
+#include "rtow/utils.hpp"
+
+namespace rtow {
+
+// bump whenever sampling or shading changes, so that tiles cached by older builds stop matching
+inline constexpr uint64_t kTileKeyVersion = 1U;
+
+/// Key of the tile [u0, u1) x [v0, v1) holding samples [first_sample, first_sample + spp): the camera
+/// model and pose, the render settings, the tile itself and the part of the scene it depends on. Paths
+/// can bounce off anything, so path tracing depends on every primitive and light; the first-hit previews
+/// only on the primitives in the tile's frustum, widened by ao_radius for ambient occlusion.
+template <typename T>
+uint64_t tile_key(const Renderer<T>& renderer, const size_t u0, const size_t v0, const size_t u1, const size_t v1,
+                  const size_t spp, const size_t first_sample) {
+  const Camera<T>& camera = renderer.camera();
+  const RenderSettings& settings = renderer.settings();
+
+  uint64_t key = hash_combine(kTileKeyVersion, sizeof(T));
+  key = hash_combine_value(hash_combine_value(key, camera.width()), camera.height());
+  for (size_t i = 0; i < camera.model_size(); ++i) {
+    key = hash_combine_value(key, camera.params()[i]);
+  }
+  key = hash_combine_value(hash_combine_value(key, renderer.rotation()), renderer.translation());
+
+  key = hash_combine(key, static_cast<uint64_t>(settings.integrator));
+  key = hash_combine(key, settings.max_ray_bounces);
+  key = hash_combine(key, settings.ao_rays);
+  key = hash_combine_value(hash_combine_value(key, settings.ao_radius), settings.depth_range);
+  key = hash_combine(key, settings.seed);
+  key = hash_combine(hash_combine(key, spp), first_sample);
+  key = hash_combine(hash_combine(key, u0), v0);
+  key = hash_combine(hash_combine(key, u1), v1);
+
+  switch (settings.integrator) {
+    case IntegratorType::NORMALS:
+    case IntegratorType::DEPTH:
+    case IntegratorType::AMBIENT_OCCLUSION: {
+      const T margin = settings.integrator == IntegratorType::AMBIENT_OCCLUSION ? T(settings.ao_radius) : T(0);
+      const TileFrustum<T> frustum = renderer.tile_frustum(u0, v0, u1, v1);
+      return hash_combine(key, renderer.world().fingerprint([&](const Vec3<T>& center, const T radius) {
+        return frustum.overlaps(center, radius, margin);
+      }));
+    }
+    case IntegratorType::PATH:
+    case IntegratorType::UNKNOWN:
+    default:
+      return hash_combine(hash_combine(key, renderer.world().fingerprint()), renderer.lights().fingerprint());
+  }
+}
+
+/// Renderer::render_pass backed by a tile cache: every tile whose key is in 'cache' is loaded instead of
+/// rendered, and every rendered tile is stored. Tiles are the renderer's tile_size. Samples are seeded
+/// per pixel, so into an empty accumulator the result is bit-identical to render_pass.
+template <typename T>
+void render_pass_cached(const Renderer<T>& renderer, TileCache& cache, Image& accumulator, const size_t spp,
+                        const size_t first_sample = 0) {
+  renderer.for_each_tile(accumulator.width(), accumulator.height(), renderer.settings().tile_size,
+                         [&](const size_t u0, const size_t v0, const size_t u1, const size_t v1) {
+    Image tile = {u1 - u0, v1 - v0, PIXEL_FORMAT::RGB};
+    tile.alloc();
+
+    const uint64_t key = tile_key(renderer, u0, v0, u1, v1, spp, first_sample);
+    if (!cache.load(key, tile)) {
+      const auto visible = renderer.tile_scene(u0, v0, u1, v1);
+      for (size_t v = v0; v < v1; ++v) {
+        for (size_t u = u0; u < u1; ++u) {
+          color& sum = tile.at(u - u0, v - v0);
+          for (size_t k = first_sample; k < first_sample + spp; ++k) {
+            renderer.add_sample(sum, u, v, k, visible.get());
+          }
+        }
+      }
+      cache.store(key, tile);
+    }
+
+    for (size_t v = v0; v < v1; ++v) {
+      for (size_t u = u0; u < u1; ++u) {
+        accumulator.at(u, v) += tile.at(u - u0, v - v0);
+      }
+    }
+  });
+}
+
+}  // namespace rtow
@@ -3,6 +3,9 @@
 namespace rtow {
 using color = Vec3f;
 
+/// Rec. 709 luminance of a linear color.
+float luminance(const color& c);
+
 // note: 'col' values will be scaled by a factor of 255.9
 void write_color(std::ostream& out, const color& col);
 
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "rtow/alias_table.h"
+#include "rtow/image.h"
+#include "rtow/light.hpp"
+#include "rtow/utils.hpp"
+
+namespace rtow {
+
+/// Light at infinity given by an equirectangular (latitude-longitude) radiance image, e.g. an HDR PFM.
+/// The top row looks straight up, which in this renderer's worlds is -y; u runs around the vertical
+/// axis starting from -x. Radiance is constant over each texel, so sampling can match it exactly: a
+/// texel is drawn from an alias table weighted by its luminance times the solid angle it covers, then a
+/// point uniformly within it. Bright features such as the sun are found at once instead of by chance.
+template <typename T = float>
+class EnvironmentLight : public Light<T> {
+public:
+  explicit EnvironmentLight(const Image& radiance, const float scale = 1.F)
+      : width_(radiance.width())
+      , height_(radiance.height())
+      , texels_(width_ * height_)
+      , scale_(scale) {
+    std::vector<double> weights(texels_.size());
+    for (size_t v = 0; v < height_; ++v) {
+      const double sin_theta = std::sin(M_PI * (static_cast<double>(v) + 0.5) / static_cast<double>(height_));
+      for (size_t u = 0; u < width_; ++u) {
+        const color c = radiance.at(u, v) * scale_;
+        texels_[v * width_ + u] = c;
+        weights[v * width_ + u] = std::max(static_cast<double>(luminance(c)), 0.) * sin_theta;
+      }
+    }
+    distribution_ = AliasTable(weights);
+  }
+
+  size_t width() const { return width_; }
+  size_t height() const { return height_; }
+
+  /// Radiance arriving from 'direction' (any length).
+  color radiance(const Vec3<T>& direction) const {
+    if (texels_.empty()) return color(0.F);
+    return texels_[texel(normalize(direction))];
+  }
+
+  bool sample(const Vec3<T>& p, LightSample<T>& sample) const override {
+    if (distribution_.empty()) return false;
+
+    // double uniforms: a float has 24 bits, too few to reach every column of a table over 2^24 texels
+    const size_t i = distribution_.sample(random(0., 1.), random(0., 1.));
+    const T su = (static_cast<T>(i % width_) + random(T(0), T(1))) / static_cast<T>(width_);
+    const T sv = (static_cast<T>(i / width_) + random(T(0), T(1))) / static_cast<T>(height_);
+    const T theta = T(M_PI) * sv;
+    const T phi = T(2 * M_PI) * su - T(M_PI);
+    const T sin_theta = std::sin(theta);
+    if (!(sin_theta > T(0))) return false;
+
+    sample.direction = {sin_theta * std::cos(phi), -std::cos(theta), sin_theta * std::sin(phi)};
+    sample.distance = std::numeric_limits<T>::infinity();
+    sample.pdf = texel_pdf(i, sin_theta);
+    sample.radiance = texels_[i];
+    return sample.pdf > T(0);
+  }
+
+  T pdf(const Vec3<T>& p, const Vec3<T>& direction) const override {
+    if (distribution_.empty()) return T(0);
+    const Vec3<T> d = normalize(direction);
+    const T sin_theta = std::sqrt(std::max(T(0), T(1) - d[1] * d[1]));
+    return sin_theta > T(0) ? texel_pdf(texel(d), sin_theta) : T(0);
+  }
+
+  bool distance(const Vec3<T>& p, const Vec3<T>& direction, T& distance) const override {
+    distance = std::numeric_limits<T>::infinity();
+    return true;
+  }
+
+  uint64_t fingerprint() const override {
+    uint64_t hash = hash_combine(hash_combine(5U, width_), height_);
+    for (const color& c : texels_) {
+      hash = hash_combine_value(hash, c);
+    }
+    return hash;
+  }
+
+private:
+  /// Texel seen in the unit direction 'd'.
+  size_t texel(const Vec3<T>& d) const {
+    const T theta = std::acos(std::clamp(-d[1], T(-1), T(1)));
+    const T phi = std::atan2(d[2], d[0]);
+    const auto u = static_cast<size_t>((phi + T(M_PI)) / T(2 * M_PI) * static_cast<T>(width_));
+    const auto v = static_cast<size_t>(theta / T(M_PI) * static_cast<T>(height_));
+    return std::min(v, height_ - 1) * width_ + std::min(u, width_ - 1);
+  }
+
+  /// Solid-angle pdf of a point in texel 'i' at polar angle sin(theta): the texel's probability spread
+  /// over its area in (u, v), times the Jacobian 1 / (2 pi^2 sin(theta)) of the mapping.
+  T texel_pdf(const size_t i, const T sin_theta) const {
+    const auto texels = static_cast<T>(width_ * height_);
+    return static_cast<T>(distribution_.probability(i)) * texels / (T(2 * M_PI * M_PI) * sin_theta);
+  }
+
+  size_t width_ = 0;
+  size_t height_ = 0;
+  std::vector<color> texels_;
+  float scale_ = 1.F;
+  AliasTable distribution_;
+};
+
+}  // namespace rtow
@@ -0,0 +1,46 @@
+#pragma once
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "rtow/bounded_queue.hpp"
+#include "rtow/postprocess.h"
+
+namespace rtow {
+
+/// Encodes and writes finished frames on a background thread so the next frame can be rendered in the
+/// meantime. At most 'queue_depth' frames wait to be written; write() blocks beyond that.
+class FrameWriter {
+public:
+  explicit FrameWriter(size_t queue_depth = 2, std::ostream& log = std::cout);
+  ~FrameWriter();
+
+  FrameWriter(const FrameWriter&) = delete;
+  FrameWriter& operator=(const FrameWriter&) = delete;
+
+  /// Queues a display-ready frame (see post_process) to be written to 'file_path' as a PPM.
+  void write(const std::string& file_path, Image8&& image);
+
+  /// Blocks until every queued frame is on disk.
+  void finish();
+
+  /// Time spent encoding and writing, i.e. what was hidden behind rendering.
+  double busy_ms() const { return busy_us_.load() * 1e-3; }
+  size_t frames_written() const { return frames_written_.load(); }
+
+private:
+  struct Frame {
+    std::string file_path;
+    Image8 image;
+  };
+
+  void loop();
+
+  BoundedQueue<Frame> queue_;
+  std::ostream& log_;
+  std::thread thread_;
+  std::atomic<int64_t> busy_us_ = 0;
+  std::atomic<size_t> frames_written_ = 0;
+};
+
+}  // namespace rtow
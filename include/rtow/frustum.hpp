@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cmath>
+
+#include "rtow/camera.hpp"
+#include "rtow/rigid_transform.hpp"
+#include "rtow/vec_utils.hpp"
+
+namespace rtow {
+
+/// World-frame pyramid of the rays through the image rectangle [u0, u1] x [v0, v1] of a pinhole camera:
+/// its apex at the camera center and four side planes through the rectangle's corner rays. Built once
+/// per tile, after which testing a bounding sphere costs four dot products.
+template <typename T = float>
+struct TileFrustum {
+  Vec3<T> apex;
+  Vec3<T> normals[4];  // unit, pointing into the frustum
+
+  TileFrustum(const Camera<T>& camera, const RigidTransform<T>& T_world_camera, const T u0, const T v0, const T u1,
+              const T v1)
+      : apex(T_world_camera.translation()) {
+    const Vec3<T> corners[4] = {T_world_camera.transform_dir(camera.unproject({u0, v0}).direction()),
+                                T_world_camera.transform_dir(camera.unproject({u1, v0}).direction()),
+                                T_world_camera.transform_dir(camera.unproject({u1, v1}).direction()),
+                                T_world_camera.transform_dir(camera.unproject({u0, v1}).direction())};
+    const Vec3<T> axis = corners[0] + corners[1] + corners[2] + corners[3];
+    for (size_t i = 0; i < 4; ++i) {
+      normals[i] = normalize(cross(corners[i], corners[(i + 1) % 4]));
+      if (dot(normals[i], axis) < T(0)) normals[i] = -normals[i];
+    }
+  }
+
+  /// True if a sphere can be seen through the rectangle, or comes within 'margin' of something that can.
+  /// Conservative: a sphere that only overlaps the pyramid near an edge may pass, and the planes are
+  /// widened by a little more than their rounding error.
+  bool overlaps(const Vec3<T>& center, const T radius, const T margin = T(0)) const {
+    const Vec3<T> offset = center - apex;
+    const T slack = T(1e-5) * (std::abs(offset[0]) + std::abs(offset[1]) + std::abs(offset[2]));
+    for (size_t i = 0; i < 4; ++i) {
+      if (dot(normals[i], offset) < -(radius + margin + slack)) return false;
+    }
+    return true;
+  }
+};
+
+}  // namespace rtow
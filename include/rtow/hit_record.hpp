@@ -1,10 +1,22 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+
+#include "rtow/ray.hpp"
+#include "rtow/vec_utils.hpp"
+
 namespace rtow {
 
 template <typename T>
 class Material;
 
+template <typename T>
+class Hittable;
+
 template <typename T>
 struct HitRecord {
   Vec3<T> p;
@@ -12,6 +24,9 @@ struct HitRecord {
   T t = std::numeric_limits<T>::quiet_NaN();
   bool front_face = true;
   std::shared_ptr<Material<T>> material_ptr = nullptr;
+  // surface parameters, only filled in for materials that ask for them (Material::needs_uv)
+  Vec2<T> uv = {T(0)};
+  T uv_width = T(0);  // width of the ray's footprint in uv units
 
   void Update(const Vec3<T>& p, const Vec3<T>& outward_normal, const T t, const Ray<T>& ray,
               const std::shared_ptr<Material<T>>& material_ptr) {
@@ -22,6 +37,26 @@ struct HitRecord {
     this->n = front_face ? outward_normal : -outward_normal;
     this->material_ptr = material_ptr;
   }
+
+  /// uv of a sphere hit from its outward unit normal: u around the y axis, v from the pole at -y to +y,
+  /// both in [0, 1]. The footprint uses the circumference, the u extent at the equator, and grows with
+  /// the slant of the surface to the ray.
+  void UpdateSphereUV(const Vec3<T>& outward_normal, const T radius, const Ray<T>& ray) {
+    uv[0] = std::atan2(-outward_normal[2], outward_normal[0]) / T(2 * M_PI) + T(0.5);
+    uv[1] = std::acos(std::clamp(-outward_normal[1], T(-1), T(1))) / T(M_PI);
+    const T cos_theta = std::abs(dot(normalize(ray.direction()), outward_normal));
+    uv_width = ray.cone_width(t) / (T(2 * M_PI) * std::abs(radius) * std::max(cos_theta, T(0.1)));
+  }
+};
+
+/// Closest intersection found so far by an intersect query: just the distance and which primitive, so
+/// that traversal stays cheap. The hit attributes are computed once, for the winner, by finalize_hit.
+template <typename T>
+struct PrimitiveHit {
+  T t = std::numeric_limits<T>::infinity();
+  uint32_t primitive = UINT32_MAX;  // index within 'object'
+  uint32_t instance = UINT32_MAX;   // set by instancing structures, which also become 'object'
+  const Hittable<T>* object = nullptr;  // finalizes the hit; null while nothing was hit
 };
 
-}  // namespace rtow
\ No newline at end of file
+}  // namespace rtow
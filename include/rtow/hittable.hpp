@@ -1,11 +1,18 @@
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <vector>
 
+#include "rtow/hit_record.hpp"
 #include "rtow/material.hpp"
 #include "rtow/ray.hpp"
 namespace rtow {
+
+/// Selects primitives by bounding sphere, e.g. those that can show up in part of the image.
+template <typename T>
+using BoundsFilter = std::function<bool(const Vec3<T>& center, T radius)>;
+
 template <typename T>
 class Hittable {
 public:
@@ -13,7 +20,45 @@ public:
   Hittable(const std::shared_ptr<Material<T>>& material_ptr)
       : material_ptr_(material_ptr) {}
 
-  virtual bool hit(const Ray<T>& ray, const T t_min, const T t_max, HitRecord<T>& record) const = 0;
+  /// Closest hit within [t_min, t_max], with its attributes.
+  virtual bool hit(const Ray<T>& ray, const T t_min, const T t_max, HitRecord<T>& record) const {
+    PrimitiveHit<T> primitive_hit;
+    if (!intersect(ray, t_min, t_max, primitive_hit)) return false;
+    primitive_hit.object->finalize_hit(ray, primitive_hit, record);
+    return true;
+  }
+
+  /// Closest-hit query without attributes: updates 'hit' (and returns true) only for an intersection within
+  /// [t_min, t_max] that is strictly closer than hit.t, so several hittables can share one 'hit'.
+  virtual bool intersect(const Ray<T>& ray, const T t_min, const T t_max, PrimitiveHit<T>& hit) const = 0;
+
+  /// Hit attributes of an intersection found by this hittable's intersect (hit.object == this).
+  virtual void finalize_hit(const Ray<T>& ray, const PrimitiveHit<T>& hit, HitRecord<T>& record) const = 0;
+
+  /// Any-hit query: true if anything intersects the ray within [t_min, t_max]. Implementations stop at the
+  /// first intersection found and never compute hit attributes.
+  virtual bool occluded(const Ray<T>& ray, const T t_min, const T t_max) const {
+    HitRecord<T> record;
+    return hit(ray, t_min, t_max, record);
+  }
+
+  /// Hash of the geometry and materials of the primitives whose bounding sphere passes 'filter' (all of
+  /// them if it is empty). Primitives that fail the filter still count, as placeholders, so that
+  /// adding or removing one changes the fingerprint.
+  virtual uint64_t fingerprint(const BoundsFilter<T>& filter = {}) const = 0;
+
+  /// Bounding sphere of a single bounded primitive; false for aggregates and unbounded objects.
+  virtual bool bounding_sphere(Vec3<T>& center, T& radius) const { return false; }
+
+  /// The primitives whose bounding sphere passes 'filter', in their original order, e.g. the candidates
+  /// for the primary rays of one tile. Null if this hittable can't be split up; use it whole then.
+  virtual std::shared_ptr<const Hittable<T>> cull(const BoundsFilter<T>& filter) const { return nullptr; }
+
+  /// A deep copy of the geometry, allocated by the calling thread (e.g. a node-local replica on a NUMA
+  /// machine); materials stay shared. Null if this hittable can't be copied; share it then.
+  virtual std::shared_ptr<Hittable<T>> replicate() const { return nullptr; }
+
+  const std::shared_ptr<Material<T>>& material() const { return material_ptr_; }
 
 protected:
   std::shared_ptr<Material<T>> material_ptr_ = nullptr;
@@ -26,22 +71,51 @@ public:
 
   void add(const std::shared_ptr<Hittable<T>>& object) { objects_.push_back(object); }
   void clear() { objects_.clear(); }
-  bool hit(const Ray<T>& ray, const T t_min, const T t_max, HitRecord<T>& record) const override {
-    HitRecord<T> temp_rec;
+  bool intersect(const Ray<T>& ray, const T t_min, const T t_max, PrimitiveHit<T>& hit) const override {
+    // the children finalize their own hits
     bool hit_anything = false;
-    T closest_so_far = t_max + T(0.1);
+    for (const auto& object_ptr : objects_) {
+      hit_anything |= object_ptr->intersect(ray, t_min, t_max, hit);
+    }
+    return hit_anything;
+  }
 
+  // never called: the children's intersect names the child itself as hit.object
+  void finalize_hit(const Ray<T>& ray, const PrimitiveHit<T>& hit, HitRecord<T>& record) const override {}
+
+  bool occluded(const Ray<T>& ray, const T t_min, const T t_max) const override {
     for (const auto& object_ptr : objects_) {
-      if (object_ptr->hit(ray, t_min, t_max, temp_rec)) {
-        if (temp_rec.t < closest_so_far) {
-          hit_anything = true;
-          closest_so_far = temp_rec.t;
-          record = temp_rec;
-        }
-      }
+      if (object_ptr->occluded(ray, t_min, t_max)) return true;
     }
+    return false;
+  }
 
-    return hit_anything;
+  std::shared_ptr<const Hittable<T>> cull(const BoundsFilter<T>& filter) const override {
+    auto subset = std::make_shared<HittableList<T>>();
+    Vec3<T> center;
+    T radius = T(0);
+    for (const auto& object_ptr : objects_) {
+      if (!object_ptr->bounding_sphere(center, radius) || filter(center, radius)) subset->add(object_ptr);
+    }
+    return subset;
+  }
+
+  std::shared_ptr<Hittable<T>> replicate() const override {
+    auto copy = std::make_shared<HittableList<T>>();
+    for (const auto& object_ptr : objects_) {
+      auto child = object_ptr->replicate();
+      if (child == nullptr) return nullptr;
+      copy->add(child);
+    }
+    return copy;
+  }
+
+  uint64_t fingerprint(const BoundsFilter<T>& filter = {}) const override {
+    uint64_t hash = objects_.size();
+    for (const auto& object_ptr : objects_) {
+      hash = hash_combine(hash, object_ptr->fingerprint(filter));
+    }
+    return hash;
   }
 
 private:
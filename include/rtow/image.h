@@ -1,5 +1,9 @@
 #pragma once
+#include <cstdint>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "rtow/color.h"
@@ -19,6 +23,13 @@ struct Image {
     return true;
   }
 
+  /// Like alloc(), but leaves the pixels unwritten, so the caller decides which thread first touches each
+  /// page (see Renderer::alloc). Every pixel must be written before it is read.
+  bool alloc_uninitialized() {
+    data_.resize(width_ * height_);
+    return true;
+  }
+
   color* data() { return data_.data(); }
 
   const color* data() const { return data_.data(); }
@@ -33,9 +44,42 @@ struct Image {
 private:
   size_t width_ = 0;
   size_t height_ = 0;
-  std::vector<color> data_;
+  // leaves memory untouched on resize() without a value, which is what lets alloc_uninitialized() leave
+  // the first touch of each page to the caller
+  template <typename U>
+  struct UninitializedAllocator : std::allocator<U> {
+    template <typename V>
+    struct rebind {
+      using other = UninitializedAllocator<V>;
+    };
+    UninitializedAllocator() = default;
+    template <typename V>
+    UninitializedAllocator(const UninitializedAllocator<V>&) {}
+
+    template <typename V>
+    void construct(V*) noexcept {}
+    template <typename V, typename... Args>
+    void construct(V* p, Args&&... args) {
+      ::new (static_cast<void*>(p)) V(std::forward<Args>(args)...);
+    }
+  };
+
+  std::vector<color, UninitializedAllocator<color>> data_;
   PIXEL_FORMAT pf_ = PIXEL_FORMAT::UNKNOWN;
 };
 
 void to_ppm(const Image& image, std::ostream& out, std::ostream& log = std::cout, bool write_header = true);
+
+// Writes 'height' rows of 8-bit interleaved RGB as PPM text
+void to_ppm(const uint8_t* rgb, size_t width, size_t height, std::ostream& out, bool write_header = true);
+
+// Averages an image of per-pixel radiance sums over 'samples_per_pixel' and gamma-corrects it into 'out'
+void resolve(const Image& accumulator, size_t samples_per_pixel, Image& out);
+
+// Reads a float PFM ("PF" color or "Pf" grey, either byte order) into 'out', top row first. Returns false
+// if the file can't be read or is malformed.
+bool read_pfm(const std::string& path, Image& out);
+
+// Writes a little-endian color PFM
+bool write_pfm(const std::string& path, const Image& image);
 }  // namespace rtow
\ No newline at end of file
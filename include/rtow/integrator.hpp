@@ -0,0 +1,178 @@
+#pragma once
+
+#include <limits>
+
+#include "rtow/color.h"
+#include "rtow/environment.hpp"
+#include "rtow/hittable.hpp"
+#include "rtow/light.hpp"
+#include "rtow/ray.hpp"
+
+namespace rtow {
+
+enum class IntegratorType { UNKNOWN = -1, PATH = 0, NORMALS = 1, DEPTH = 2, AMBIENT_OCCLUSION = 3 };
+
+/// Sky gradient seen by rays that leave the scene.
+template <typename T>
+inline color sky_color(const Ray<T>& ray) {
+  const Vec3<T> dir = normalize(ray.direction());
+  const float t = static_cast<float>(dir.y()) + .5f;
+  return color(1.) * t + color(0.5f, 0.7f, 1.f) * (1.f - t);
+}
+
+/// MIS weight of strategy 'a' against strategy 'b' (Veach's power heuristic, beta = 2).
+template <typename T>
+inline T power_heuristic(const T pdf_a, const T pdf_b) {
+  const T a2 = pdf_a * pdf_a;
+  const T b2 = pdf_b * pdf_b;
+  return (a2 + b2) > T(0) ? a2 / (a2 + b2) : T(0);
+}
+
+// ray extent used by every integrator
+template <typename T>
+inline constexpr T kRayEpsilon = T(0.001);
+template <typename T>
+inline constexpr T kRayFar = T(1000.);
+
+/// State of one light path between bounces.
+template <typename T>
+struct PathState {
+  Ray<T> ray;
+  color throughput = {1.F};
+  color radiance = {0.F};
+  T bsdf_pdf = T(0);
+  bool specular_bounce = true;  // camera rays and delta lobes see emitters unweighted
+  bool active = true;
+};
+
+/// Advances 'path' by one bounce, given the closest hit of its current ray ('record' is null on a miss):
+/// adds emission and one next-event estimate to the path's radiance and continues it along the BSDF sample.
+/// Every diffuse bounce samples one light from 'lights' and traces a shadow ray to it; emitters hit by
+/// BSDF-sampled rays are MIS-weighted against that strategy.
+template <typename T>
+void shade_path(PathState<T>& path, const HitRecord<T>* record, const Hittable<T>& world,
+                const LightList<T>& lights) {
+  const Ray<T>& ray_in = path.ray;
+  if (record == nullptr) {
+    // background -- no-hit; an environment is also sampled by next-event estimation, so weight it
+    if (const EnvironmentLight<T>* environment = lights.environment()) {
+      T weight = T(1);
+      if (!path.specular_bounce) {
+        const T light_pdf =
+            lights.pdf(ray_in.origin(), normalize(ray_in.direction()), std::numeric_limits<T>::infinity());
+        weight = power_heuristic(path.bsdf_pdf, light_pdf);
+      }
+      path.radiance += path.throughput * environment->radiance(ray_in.direction()) * static_cast<float>(weight);
+    } else {
+      path.radiance += path.throughput * sky_color(ray_in);
+    }
+    path.active = false;
+    return;
+  }
+
+  const Material<T>& material = *record->material_ptr;
+
+  const color emitted = material.emitted(ray_in, *record);
+  if (emitted.norm_squared() > 0.F) {
+    T weight = T(1);
+    if (!path.specular_bounce) {
+      // weighed against sampling the light that was hit, with the probability of picking it
+      const T length = ray_in.direction().norm();
+      const T light_pdf = lights.pdf(ray_in.origin(), ray_in.direction() / length, record->t * length);
+      weight = power_heuristic(path.bsdf_pdf, light_pdf);
+    }
+    path.radiance += path.throughput * emitted * static_cast<float>(weight);
+  }
+
+  // next-event estimation
+  if (material.is_diffuse() && !lights.empty()) {
+    LightSample<T> light_sample;
+    color f;
+    T pdf = T(0);
+    if (lights.sample(record->p, light_sample) && material.eval(ray_in, *record, light_sample.direction, f, pdf)) {
+      const Ray<T> shadow_ray = {record->p, light_sample.direction};
+      if (!world.occluded(shadow_ray, kRayEpsilon<T>, light_sample.distance * (T(1) - kRayEpsilon<T>))) {
+        const T weight = power_heuristic(light_sample.pdf, pdf);
+        path.radiance +=
+            path.throughput * f * light_sample.radiance * static_cast<float>(weight / light_sample.pdf);
+      }
+    }
+  }
+
+  color attenuation;
+  Ray<T> ray_out;
+  if (!material.scatter(ray_in, *record, attenuation, ray_out)) {
+    // light ray got absorbed
+    path.active = false;
+    return;
+  }
+
+  path.specular_bounce = !material.is_diffuse();
+  if (!path.specular_bounce) {
+    color f;
+    if (!material.eval(ray_in, *record, ray_out.direction(), f, path.bsdf_pdf)) path.bsdf_pdf = T(0);
+  }
+
+  path.throughput *= attenuation;
+  // the ray cone carries on from the footprint at the hit, so later hits pick coarser texture detail
+  path.ray = {ray_out.origin(), ray_out.direction(), ray_in.cone_width(record->t), ray_in.spread()};
+}
+
+/// Path tracer with next-event estimation, see shade_path. The camera ray is traced against 'primary'
+/// when given (a culled subset of 'world' that holds everything the ray can hit), all others against 'world'.
+template <typename T>
+color ray_color(const Ray<T>& r, const Hittable<T>& world, const LightList<T>& lights,
+                const size_t max_bounces, const Hittable<T>* primary = nullptr) {
+  HitRecord<T> record;
+  PathState<T> path;
+  path.ray = r;
+
+  for (size_t depth = 0; depth < max_bounces && path.active; ++depth) {
+    const Hittable<T>& scene = depth == 0 && primary != nullptr ? *primary : world;
+    const bool hit = scene.hit(path.ray, kRayEpsilon<T>, kRayFar<T>, record);
+    shade_path(path, hit ? &record : nullptr, world, lights);
+  }
+
+  return path.radiance;
+}
+
+/// First-hit preview: surface normals mapped to [0, 1].
+template <typename T>
+color normals_color(const Ray<T>& ray, const Hittable<T>& world) {
+  HitRecord<T> record;
+  if (world.hit(ray, kRayEpsilon<T>, kRayFar<T>, record)) {
+    return (color{1., 1., 1.} + record.n) * 0.5f;
+  }
+  return sky_color(ray);
+}
+
+/// First-hit preview: distance along the (unit) ray, white up close fading to black at 'depth_range'.
+template <typename T>
+color depth_color(const Ray<T>& ray, const Hittable<T>& world, const T depth_range) {
+  HitRecord<T> record;
+  if (world.hit(ray, kRayEpsilon<T>, kRayFar<T>, record)) {
+    const T distance = record.t * ray.direction().norm();
+    return color(static_cast<float>(T(1) - std::min(distance / depth_range, T(1))));
+  }
+  return color(0.F);
+}
+
+/// Ambient-occlusion preview: fraction of 'num_rays' cosine-distributed rays of length 'radius' that
+/// escape from the first hit. Uses any-hit queries only. The first hit is found in 'primary' when given.
+template <typename T>
+color ambient_occlusion(const Ray<T>& ray, const Hittable<T>& world, const size_t num_rays, const T radius,
+                        const Hittable<T>* primary = nullptr) {
+  HitRecord<T> record;
+  const Hittable<T>& first = primary != nullptr ? *primary : world;
+  if (!first.hit(ray, kRayEpsilon<T>, kRayFar<T>, record)) return sky_color(ray);
+  if (num_rays == 0) return color(1.F);
+
+  size_t unoccluded = 0;
+  for (size_t i = 0; i < num_rays; ++i) {
+    const Ray<T> ao_ray = {record.p, random_cosine_direction(record.n)};
+    if (!world.occluded(ao_ray, kRayEpsilon<T>, radius)) ++unoccluded;
+  }
+  return color(static_cast<float>(unoccluded) / static_cast<float>(num_rays));
+}
+
+}  // namespace rtow
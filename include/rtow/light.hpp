@@ -0,0 +1,470 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "rtow/aabb.hpp"
+#include "rtow/bvh.hpp"
+#include "rtow/color.h"
+#include "rtow/material.hpp"
+#include "rtow/sphere.hpp"
+#include "rtow/utils.hpp"
+
+namespace rtow {
+
+template <typename T>
+struct LightSample {
+  Vec3<T> direction = {Vec3<T>::NaN};  // unit vector from the shading point towards the light
+  T distance = T(0);                   // distance to the sampled point on the light
+  T pdf = T(0);                        // w.r.t solid angle at the shading point
+  color radiance = {0.F};
+};
+
+template <typename T>
+class Light {
+public:
+  /// Samples a direction from `p` towards the light. Returns false if no sample could be drawn.
+  virtual bool sample(const Vec3<T>& p, LightSample<T>& sample) const = 0;
+
+  /// Solid-angle pdf with which `sample` would pick `direction` (unit) from `p`.
+  virtual T pdf(const Vec3<T>& p, const Vec3<T>& direction) const = 0;
+
+  /// Distance from `p` along `direction` (unit) to the emitter, as `sample` reports it; infinity for
+  /// lights at infinity. Returns false if the ray misses the light.
+  virtual bool distance(const Vec3<T>& p, const Vec3<T>& direction, T& distance) const = 0;
+
+  /// Hash of the light's shape and emission.
+  virtual uint64_t fingerprint() const = 0;
+
+  /// Box around the emitter; empty for lights at infinity, which have no position.
+  virtual AABB<T> bounds() const { return {}; }
+
+  /// Emitted power (as luminance), to weigh lights with a position against each other.
+  virtual float power() const { return 0.F; }
+};
+
+/// Spherical emitter, sampled uniformly within the cone it subtends at the shading point.
+template <typename T = float>
+class SphereLight : public Light<T> {
+public:
+  SphereLight(const Vec3<T>& center, const T radius, const std::shared_ptr<Material<T>>& material_ptr)
+      : center_(center)
+      , radius_(std::abs(radius))
+      , material_ptr_(material_ptr) {
+    // radiance leaving the surface, seen from outside
+    const Vec3<T> normal = {T(1), T(0), T(0)};
+    const Ray<T> ray = {center_ + normal * (T(2) * radius_), -normal};
+    HitRecord<T> record;
+    record.Update(center_ + normal * radius_, normal, radius_, ray, material_ptr_);
+    power_ = std::max(0.F, luminance(material_ptr_->emitted(ray, record))) * static_cast<float>(4. * M_PI * M_PI) *
+             static_cast<float>(radius_ * radius_);
+  }
+
+  SphereLight(const Sphere<T>& sphere)
+      : SphereLight(sphere.center(), sphere.radius(), sphere.material()) {}
+
+  bool sample(const Vec3<T>& p, LightSample<T>& sample) const override {
+    const Vec3<T> oc = center_ - p;
+    const T d2 = oc.norm_squared();
+    const T r2 = radius_ * radius_;
+    if (d2 <= r2) return false;  // inside the light
+
+    const T cos_max = std::sqrt(T(1) - r2 / d2);
+    const T cos_theta = T(1) - random(T(0), T(1)) * (T(1) - cos_max);
+    const T sin_theta = std::sqrt(std::max(T(0), T(1) - cos_theta * cos_theta));
+    const T phi = T(2) * T(M_PI) * random(T(0), T(1));
+
+    const Vec3<T> w = oc / std::sqrt(d2);
+    Vec3<T> u, v;
+    orthonormal_basis(w, u, v);
+    sample.direction = u * (std::cos(phi) * sin_theta) + v * (std::sin(phi) * sin_theta) + w * cos_theta;
+
+    // nearest intersection of the sampled direction with the sphere
+    const T b = dot(sample.direction, oc);
+    sample.distance = b - std::sqrt(std::max(T(0), b * b - (d2 - r2)));
+    sample.pdf = T(1) / (T(2) * T(M_PI) * (T(1) - cos_max));
+
+    const Ray<T> ray = {p, sample.direction};
+    const Vec3<T> q = ray.at(sample.distance);
+    HitRecord<T> record;
+    record.Update(q, (q - center_) / radius_, sample.distance, ray, material_ptr_);
+    sample.radiance = material_ptr_->emitted(ray, record);
+
+    return sample.pdf > T(0);
+  }
+
+  T pdf(const Vec3<T>& p, const Vec3<T>& direction) const override {
+    const Vec3<T> oc = center_ - p;
+    const T d2 = oc.norm_squared();
+    const T r2 = radius_ * radius_;
+    if (d2 <= r2) return T(0);
+
+    const T cos_max = std::sqrt(T(1) - r2 / d2);
+    if (dot(direction, oc) < cos_max * std::sqrt(d2)) return T(0);  // outside the subtended cone
+
+    return T(1) / (T(2) * T(M_PI) * (T(1) - cos_max));
+  }
+
+  bool distance(const Vec3<T>& p, const Vec3<T>& direction, T& distance) const override {
+    const Vec3<T> oc = center_ - p;
+    const T d2 = oc.norm_squared();
+    const T r2 = radius_ * radius_;
+    if (d2 <= r2) return false;  // inside the light, which sample() can't be
+
+    // the same cone as pdf() and the same rounding as sample() at its edge
+    const T b = dot(direction, oc);
+    if (b < std::sqrt(T(1) - r2 / d2) * std::sqrt(d2)) return false;
+    distance = b - std::sqrt(std::max(T(0), b * b - (d2 - r2)));
+    return true;
+  }
+
+  uint64_t fingerprint() const override {
+    return hash_combine(hash_combine_value(hash_combine_value(0U, center_), radius_), material_ptr_->fingerprint());
+  }
+
+  AABB<T> bounds() const override { return AABB<T>::sphere(center_, radius_); }
+
+  /// Radiance times area times pi, the power of a Lambertian emitter.
+  float power() const override { return power_; }
+
+private:
+  Vec3<T> center_ = {Vec3<T>::NaN};
+  T radius_ = Vec3<T>::NaN;
+  std::shared_ptr<Material<T>> material_ptr_ = nullptr;
+  float power_ = 0.F;
+};
+
+/// Bounding volume hierarchy over lights with a position that picks one with probability roughly
+/// proportional to its contribution at a shading point. Every node knows the power of the lights below
+/// it; walking down from the root, a child is taken in proportion to that power over its squared
+/// distance to the point (no closer than half the child's diagonal, so nodes around the point are not
+/// overrated), and a single uniform number is rescaled at every step to make the next choice. Picking a
+/// light, and the probability of a given light, cost O(depth) instead of O(lights).
+template <typename T = float>
+class LightTree {
+public:
+  /// Builds over lights[i] for every i in 'indices'; sample() and probability() refer to lights by
+  /// their index in 'lights'. Lights with empty bounds or no power are left out.
+  void build(const std::vector<std::shared_ptr<Light<T>>>& lights, const std::vector<uint32_t>& indices) {
+    light_.clear();
+    bounds_.clear();
+    power_.clear();
+    for (const uint32_t i : indices) {
+      const AABB<T> box = lights[i]->bounds();
+      const float power = lights[i]->power();
+      if (box.empty() || !(power > 0.F)) continue;
+      light_.push_back(i);
+      bounds_.push_back(box);
+      power_.push_back(power);
+    }
+    bvh_.build(bounds_);
+
+    // power of every node, children before parents; parents and leaves for walking up
+    const auto& nodes = bvh_.nodes();
+    node_power_.assign(nodes.size(), 0.F);
+    parent_.assign(nodes.size(), UINT32_MAX);
+    leaf_of_.assign(lights.size(), UINT32_MAX);
+    for (size_t n = nodes.size(); n-- > 0;) {
+      const auto& node = nodes[n];
+      if (node.count > 0) {
+        for (uint32_t e = node.first; e < node.first + node.count; ++e) {
+          node_power_[n] += power_[bvh_.order()[e]];
+          leaf_of_[light_[bvh_.order()[e]]] = static_cast<uint32_t>(n);
+        }
+      } else {
+        node_power_[n] = node_power_[node.first] + node_power_[node.first + 1];
+        parent_[node.first] = parent_[node.first + 1] = static_cast<uint32_t>(n);
+      }
+    }
+  }
+
+  void clear() { build({}, {}); }
+  bool empty() const { return light_.empty(); }
+  size_t size() const { return light_.size(); }
+
+  /// Picks a light for shading point 'p' with the uniform number 'u'. Returns false if no light can
+  /// contribute, otherwise the light's index and the probability 'pmf' of having picked it.
+  bool sample(const Vec3<T>& p, T u, uint32_t& light, T& pmf) const {
+    if (empty()) return false;
+    const auto& nodes = bvh_.nodes();
+    pmf = T(1);
+    uint32_t n = 0;
+    while (nodes[n].count == 0) {
+      const uint32_t left = nodes[n].first;
+      const T importance_left = importance(p, nodes[left].bounds, node_power_[left]);
+      const T importance_right = importance(p, nodes[left + 1].bounds, node_power_[left + 1]);
+      const T total = importance_left + importance_right;
+      if (!(total > T(0))) return false;
+      const T p_left = importance_left / total;
+      if (u < p_left) {
+        u = std::min(u / p_left, T(1) - std::numeric_limits<T>::epsilon());
+        pmf *= p_left;
+        n = left;
+      } else {
+        u = std::min((u - p_left) / (T(1) - p_left), T(1) - std::numeric_limits<T>::epsilon());
+        pmf *= T(1) - p_left;
+        n = left + 1;
+      }
+    }
+
+    // leaves hold a few lights; pick among them the same way
+    const auto& leaf = nodes[n];
+    T total = T(0);
+    for (uint32_t e = leaf.first; e < leaf.first + leaf.count; ++e) total += entry_importance(p, bvh_.order()[e]);
+    if (!(total > T(0))) return false;
+    const T target = u * total;
+    T sum = T(0);
+    for (uint32_t e = leaf.first; e < leaf.first + leaf.count; ++e) {
+      const uint32_t entry = bvh_.order()[e];
+      const T weight = entry_importance(p, entry);
+      sum += weight;
+      if (target < sum || e + 1 == leaf.first + leaf.count) {
+        if (!(weight > T(0))) return false;
+        light = light_[entry];
+        pmf *= weight / total;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /// Probability that sample() picks 'light' (an index into the build's list) for shading point 'p'.
+  T probability(const Vec3<T>& p, const uint32_t light) const {
+    if (light >= leaf_of_.size() || leaf_of_[light] == UINT32_MAX) return T(0);
+    const auto& nodes = bvh_.nodes();
+
+    uint32_t n = leaf_of_[light];
+    T total = T(0);
+    T weight = T(0);
+    for (uint32_t e = nodes[n].first; e < nodes[n].first + nodes[n].count; ++e) {
+      const uint32_t entry = bvh_.order()[e];
+      const T importance = entry_importance(p, entry);
+      total += importance;
+      if (light_[entry] == light) weight = importance;
+    }
+    if (!(total > T(0))) return T(0);
+    T pmf = weight / total;
+
+    while (parent_[n] != UINT32_MAX) {
+      const uint32_t left = nodes[parent_[n]].first;
+      const T importance_left = importance(p, nodes[left].bounds, node_power_[left]);
+      const T importance_right = importance(p, nodes[left + 1].bounds, node_power_[left + 1]);
+      const T total_children = importance_left + importance_right;
+      if (!(total_children > T(0))) return T(0);
+      pmf *= (n == left ? importance_left : importance_right) / total_children;
+      n = parent_[n];
+    }
+    return pmf;
+  }
+
+  /// Sum over the lights whose bounds the ray from 'p' along 'direction' passes through of
+  /// probability(p, light) * light_pdf(light). Only subtrees the ray enters are visited.
+  template <typename Fn>
+  T pdf(const Vec3<T>& p, const Vec3<T>& direction, Fn&& light_pdf) const {
+    if (empty()) return T(0);
+    const auto& nodes = bvh_.nodes();
+    Vec3<T> inv_direction;
+    for (size_t a = 0; a < 3; ++a) inv_direction[a] = T(1) / direction[a];
+    const T t_max = std::numeric_limits<T>::infinity();
+
+    struct Entry {
+      uint32_t node;
+      T pmf;
+    };
+    Entry stack[Bvh<T>::kMaxDepth + 2];
+    size_t top = 0;
+    stack[top++] = {0U, T(1)};
+    T sum = T(0);
+    T t_enter = T(0);
+    while (top > 0) {
+      const Entry entry = stack[--top];
+      const auto& node = nodes[entry.node];
+      if (!node.bounds.hit(p, inv_direction, T(0), t_max, t_enter)) continue;
+
+      if (node.count > 0) {
+        T total = T(0);
+        for (uint32_t e = node.first; e < node.first + node.count; ++e) total += entry_importance(p, bvh_.order()[e]);
+        if (!(total > T(0))) continue;
+        for (uint32_t e = node.first; e < node.first + node.count; ++e) {
+          const uint32_t index = bvh_.order()[e];
+          if (!bounds_[index].hit(p, inv_direction, T(0), t_max, t_enter)) continue;
+          sum += entry.pmf * (entry_importance(p, index) / total) * light_pdf(light_[index]);
+        }
+        continue;
+      }
+
+      const uint32_t left = node.first;
+      const T importance_left = importance(p, nodes[left].bounds, node_power_[left]);
+      const T importance_right = importance(p, nodes[left + 1].bounds, node_power_[left + 1]);
+      const T total = importance_left + importance_right;
+      if (!(total > T(0))) continue;
+      if (importance_right > T(0)) stack[top++] = {left + 1, entry.pmf * (importance_right / total)};
+      if (importance_left > T(0)) stack[top++] = {left, entry.pmf * (importance_left / total)};
+    }
+    return sum;
+  }
+
+private:
+  static T importance(const Vec3<T>& p, const AABB<T>& box, const float power) {
+    const T distance_squared = (box.center() - p).norm_squared();
+    const T half_diagonal_squared = (box.max - box.min).norm_squared() * T(0.25);
+    return static_cast<T>(power) / std::max(distance_squared, half_diagonal_squared);
+  }
+
+  T entry_importance(const Vec3<T>& p, const uint32_t entry) const {
+    return importance(p, bounds_[entry], power_[entry]);
+  }
+
+  Bvh<T> bvh_;
+  std::vector<uint32_t> light_;     // per tree entry: index of the light in the build's list
+  std::vector<AABB<T>> bounds_;     // per tree entry
+  std::vector<float> power_;        // per tree entry
+  std::vector<float> node_power_;   // per node
+  std::vector<uint32_t> parent_;    // per node, UINT32_MAX for the root
+  std::vector<uint32_t> leaf_of_;   // per light of the build's list, UINT32_MAX if not in the tree
+};
+
+template <typename T>
+class EnvironmentLight;
+
+/// Explicit list of emitters used for next-event estimation. At most one of them is an environment,
+/// which is also what rays that leave the scene see.
+///
+/// Lights are picked uniformly until build_tree() is called. After that, lights at infinity are each
+/// picked as often as the whole set of lights with a position, and among those a LightTree prefers the
+/// ones that are bright and close, which is what scenes with many small lights need. Adding a light or
+/// changing the environment drops the tree until it is built again.
+template <typename T = float>
+class LightList {
+public:
+  LightList() = default;
+
+  void add(const std::shared_ptr<Light<T>>& light) {
+    lights_.push_back(light);
+    drop_tree();
+  }
+
+  /// Adds 'environment' as a light and makes it the background, replacing any previous environment.
+  void set_environment(const std::shared_ptr<EnvironmentLight<T>>& environment) {
+    if (environment_ != nullptr) lights_.erase(std::find(lights_.begin(), lights_.end(), environment_));
+    environment_ = environment;
+    if (environment_ != nullptr) lights_.push_back(environment_);
+    drop_tree();
+  }
+
+  /// The environment, or null if rays that leave the scene see the default sky.
+  const EnvironmentLight<T>* environment() const { return environment_.get(); }
+
+  /// Switches to picking lights by their estimated contribution, see the class comment.
+  void build_tree() {
+    std::vector<uint32_t> positioned;
+    infinite_.clear();
+    for (uint32_t i = 0; i < lights_.size(); ++i) {
+      (lights_[i]->bounds().empty() ? infinite_ : positioned).push_back(i);
+    }
+    tree_.build(lights_, positioned);
+    has_tree_ = true;
+  }
+
+  bool has_tree() const { return has_tree_; }
+
+  void clear() {
+    lights_.clear();
+    environment_ = nullptr;
+    drop_tree();
+  }
+  bool empty() const { return lights_.empty(); }
+  size_t size() const { return lights_.size(); }
+
+  bool sample(const Vec3<T>& p, LightSample<T>& sample) const {
+    if (lights_.empty()) return false;
+
+    if (has_tree_) {
+      const size_t strata = infinite_.size() + (tree_.empty() ? 0 : 1);
+      if (strata == 0) return false;
+      const T u = random(T(0), T(1)) * T(strata);
+      const size_t k = std::min(strata - 1, static_cast<size_t>(u));
+      if (k < infinite_.size()) {
+        if (!lights_[infinite_[k]]->sample(p, sample)) return false;
+        sample.pdf /= T(strata);
+        return true;
+      }
+      uint32_t light = 0;
+      T pmf = T(0);
+      if (!tree_.sample(p, std::min(u - T(k), T(1) - std::numeric_limits<T>::epsilon()), light, pmf)) return false;
+      if (!lights_[light]->sample(p, sample)) return false;
+      sample.pdf *= pmf / T(strata);
+      return true;
+    }
+
+    const size_t n = lights_.size();
+    const size_t i = std::min(n - 1, static_cast<size_t>(random(T(0), T(1)) * T(n)));
+    if (!lights_[i]->sample(p, sample)) return false;
+
+    sample.pdf /= T(n);
+    return true;
+  }
+
+  /// Solid-angle pdf with which sample() picks 'direction' (unit) from 'p' on the light that the direction
+  /// meets at 'distance' (infinity for a ray that left the scene), i.e. the light a BSDF-sampled ray hit.
+  /// Lights the direction also passes behind or in front of don't count: their samples along it are
+  /// occluded by, or occlude, the one that was hit, so they never deliver its radiance.
+  T pdf(const Vec3<T>& p, const Vec3<T>& direction, const T distance) const {
+    if (lights_.empty()) return T(0);
+
+    const auto pdf_if_hit = [&](const Light<T>& light) {
+      T light_distance = T(0);
+      if (!light.distance(p, direction, light_distance)) return T(0);
+      const bool hit = std::isinf(distance) ? std::isinf(light_distance)
+                                            : std::abs(light_distance - distance) <= kDistanceTolerance * distance;
+      return hit ? light.pdf(p, direction) : T(0);
+    };
+
+    if (has_tree_) {
+      const size_t strata = infinite_.size() + (tree_.empty() ? 0 : 1);
+      if (strata == 0) return T(0);
+      T sum = tree_.pdf(p, direction, [&](const uint32_t light) { return pdf_if_hit(*lights_[light]); });
+      for (const uint32_t i : infinite_) {
+        sum += pdf_if_hit(*lights_[i]);
+      }
+      return sum / T(strata);
+    }
+
+    T sum = T(0);
+    for (const auto& light : lights_) {
+      sum += pdf_if_hit(*light);
+    }
+    return sum / T(lights_.size());
+  }
+
+  /// Hash of the lights and of how they are picked, which changes the noise of a render.
+  uint64_t fingerprint() const {
+    uint64_t hash = has_tree_ ? hash_combine(lights_.size(), 1U) : lights_.size();
+    for (const auto& light : lights_) {
+      hash = hash_combine(hash, light->fingerprint());
+    }
+    return hash;
+  }
+
+private:
+  // relative difference up to which a light's distance along a direction is taken to be the hit's
+  static constexpr T kDistanceTolerance = T(1e-3);
+
+  void drop_tree() {
+    has_tree_ = false;
+    tree_.clear();
+    infinite_.clear();
+  }
+
+  std::vector<std::shared_ptr<Light<T>>> lights_;
+  std::shared_ptr<EnvironmentLight<T>> environment_;  // also in lights_
+  bool has_tree_ = false;
+  LightTree<T> tree_;              // lights with a position
+  std::vector<uint32_t> infinite_;  // the others
+};
+
+}  // namespace rtow
@@ -1,8 +1,12 @@
 #pragma once
 
+#include <memory>
+
 #include "rtow/color.h"
 #include "rtow/hit_record.hpp"
 #include "rtow/ray.hpp"
+#include "rtow/texture.h"
+#include "rtow/utils.hpp"
 #include "rtow/vec_utils.hpp"
 
 namespace rtow {
@@ -12,46 +16,127 @@ class Material {
 public:
   virtual bool scatter(const Ray<T>& ray_in, const HitRecord<T>& hit_record, color& attenuation,
                        Ray<T>& ray_out) const = 0;
+
+  /// Radiance leaving the surface towards the incoming ray; black unless the material is an emitter.
+  virtual color emitted(const Ray<T>& ray_in, const HitRecord<T>& hit_record) const { return color(0.F); }
+
+  /// Whether the BSDF is smooth enough to be evaluated for an arbitrary direction (see `eval`).
+  /// Only such materials receive direct light sampling.
+  virtual bool is_diffuse() const { return false; }
+
+  /// BSDF times cosine for scattering into `direction`, and the solid-angle pdf with which `scatter`
+  /// would have picked that direction. Returns false if the direction can't be scattered into.
+  virtual bool eval(const Ray<T>& ray_in, const HitRecord<T>& hit_record, const Vec3<T>& direction,
+                    color& f, T& pdf) const {
+    return false;
+  }
+
+  /// Hash of the material's type and parameters; materials with equal fingerprints scatter identically.
+  virtual uint64_t fingerprint() const = 0;
+
+  /// Whether hits need HitRecord::uv and uv_width. Surfaces only compute them when asked to.
+  virtual bool needs_uv() const { return false; }
+};
+
+/// Fingerprint of a surface's material, or of a placeholder (type tag 0) for surfaces without one.
+template <typename T>
+uint64_t material_fingerprint(const Material<T>* material) {
+  return material != nullptr ? material->fingerprint() : hash_combine(0U, 0U);
+}
+
+/// Albedo of a material: a constant color, or a texture looked up at the hit's uv over its footprint.
+template <typename T>
+class Albedo {
+public:
+  Albedo(const color& constant)
+      : constant_(constant) {}
+  Albedo(const std::shared_ptr<const Texture>& texture)
+      : texture_(texture) {}
+
+  color operator()(const HitRecord<T>& hit_record) const {
+    if (texture_ == nullptr) return constant_;
+    return texture_->value(static_cast<float>(hit_record.uv[0]), static_cast<float>(hit_record.uv[1]),
+                           static_cast<float>(hit_record.uv_width));
+  }
+
+  bool textured() const { return texture_ != nullptr; }
+
+  // constant albedos hash as they did before textures existed, so tile cache keys stay valid
+  uint64_t hash(const uint64_t seed) const {
+    return texture_ == nullptr ? hash_combine_value(seed, constant_) : hash_combine(seed, texture_->fingerprint());
+  }
+
+private:
+  color constant_ = {color::NaN};
+  std::shared_ptr<const Texture> texture_;
 };
 
 template <typename T>
 class Lambertian : public Material<T> {
 public:
+  Lambertian(const Albedo<T>& albedo)
+      : albedo_(albedo) {}
   Lambertian(const color& albedo)
       : albedo_(albedo) {}
+  Lambertian(const std::shared_ptr<const Texture>& albedo)
+      : albedo_(albedo) {}
 
   bool scatter(const Ray<T>& ray_in, const HitRecord<T>& hit_record, color& attenuation,
                Ray<T>& ray_out) const override {
-    Vec3<T> scatter_direction = hit_record.n + normalize(Vec3<T>::random(T(-1), T(1)));
-    // check for near zero
-    scatter_direction = scatter_direction.norm() < T(1e-3) ? hit_record.n : scatter_direction;
+    ray_out = {hit_record.p, random_cosine_direction(hit_record.n)};
+    attenuation = albedo_(hit_record);
+    return true;
+  }
 
-    ray_out = {hit_record.p, scatter_direction};
-    attenuation = albedo_;
+  bool is_diffuse() const override { return true; }
+
+  bool eval(const Ray<T>& ray_in, const HitRecord<T>& hit_record, const Vec3<T>& direction, color& f,
+            T& pdf) const override {
+    const T cos_theta = dot(hit_record.n, normalize(direction));
+    if (cos_theta <= T(0)) {
+      pdf = T(0);
+      return false;
+    }
+
+    // scatter() samples the cosine lobe, so f*cos/pdf reduces to the albedo
+    pdf = cos_theta / T(M_PI);
+    f = albedo_(hit_record) * static_cast<float>(pdf);
     return true;
   }
 
+  uint64_t fingerprint() const override { return albedo_.hash(1U); }
+  bool needs_uv() const override { return albedo_.textured(); }
+
 private:
-  color albedo_ = {color::NaN};
+  Albedo<T> albedo_;
 };
 
 template <typename T>
 class Metal : public Material<T> {
 public:
+  Metal(const Albedo<T>& albedo, const T fuzz_factor)
+      : albedo_(albedo)
+      , fuzz_factor_(fuzz_factor) {}
   Metal(const color& albedo, const T fuzz_factor)
       : albedo_(albedo)
       , fuzz_factor_(fuzz_factor) {}
+  Metal(const std::shared_ptr<const Texture>& albedo, const T fuzz_factor)
+      : albedo_(albedo)
+      , fuzz_factor_(fuzz_factor) {}
 
   bool scatter(const Ray<T>& ray_in, const HitRecord<T>& hit_record, color& attenuation,
                Ray<T>& ray_out) const override {
     const Vec3<T> reflected = reflect(ray_in.direction(), hit_record.n);
     ray_out = {hit_record.p, (reflected + fuzz_factor_ * random_in_unit_sphere<T>())};
-    attenuation = albedo_;
+    attenuation = albedo_(hit_record);
     return (dot(ray_out.direction(), hit_record.n) > T(0.0001));
   }
 
+  uint64_t fingerprint() const override { return hash_combine_value(albedo_.hash(2U), fuzz_factor_); }
+  bool needs_uv() const override { return albedo_.textured(); }
+
 private:
-  color albedo_ = {color::NaN};
+  Albedo<T> albedo_;
   T fuzz_factor_ = T(0);
 };
 
@@ -83,6 +168,8 @@ public:
     return true;
   }
 
+  uint64_t fingerprint() const override { return hash_combine_value(3U, refractive_index_); }
+
 private:
   T refractive_index_ = T(1);
 
@@ -94,4 +181,26 @@ private:
   }
 };
 
+template <typename T>
+class DiffuseLight : public Material<T> {
+public:
+  DiffuseLight(const color& emit)
+      : emit_(emit) {}
+
+  bool scatter(const Ray<T>& ray_in, const HitRecord<T>& hit_record, color& attenuation,
+               Ray<T>& ray_out) const override {
+    return false;
+  }
+
+  color emitted(const Ray<T>& ray_in, const HitRecord<T>& hit_record) const override {
+    // one-sided emitter; the inside of a light is dark
+    return hit_record.front_face ? emit_ : color(0.F);
+  }
+
+  uint64_t fingerprint() const override { return hash_combine_value(4U, emit_); }
+
+private:
+  color emit_ = {color::NaN};
+};
+
 }  // namespace rtow
\ No newline at end of file
@@ -195,9 +195,9 @@ public:
   }
 
 private:
-  const size_t rows_ = ROWS;
-  const size_t cols_ = COLS;
-  const size_t n_ = ROWS * COLS;
+  static constexpr size_t rows_ = ROWS;
+  static constexpr size_t cols_ = COLS;
+  static constexpr size_t n_ = ROWS * COLS;
   std::array<T, ROWS * COLS> data_;
 };
 
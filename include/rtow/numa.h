@@ -0,0 +1,29 @@
+#pragma once
+#include <string>
+#include <vector>
+
+namespace rtow {
+
+/// CPUs of each NUMA node, as the kernel reports them. Machines (or kernels) without NUMA information
+/// come out as a single node holding every CPU, so code written against nodes runs unchanged there.
+struct NumaTopology {
+  std::vector<std::vector<size_t>> node_cpus;  // never empty, and no node is empty
+
+  size_t num_nodes() const { return node_cpus.size(); }
+
+  /// Reads <sysfs_root>/node<i>/cpulist for every node directory. The root is a parameter so tests can
+  /// point it at a fake tree.
+  static NumaTopology detect(const std::string& sysfs_root = "/sys/devices/system/node");
+
+  /// One node with CPUs [0, hardware_concurrency).
+  static NumaTopology single_node();
+};
+
+/// Parses a kernel CPU list such as "0-3,8,10-11". Returns an empty list if it is malformed.
+std::vector<size_t> parse_cpu_list(const std::string& list);
+
+/// Restricts the calling thread to 'cpus'. Returns false, leaving the thread as it was, if the platform
+/// does not support it or the kernel refuses (e.g. none of the CPUs are available to the process).
+bool pin_current_thread(const std::vector<size_t>& cpus);
+
+}  // namespace rtow
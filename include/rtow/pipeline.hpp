@@ -0,0 +1,162 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rtow/bounded_queue.hpp"
+#include "rtow/image.h"
+#include "rtow/postprocess.h"
+#include "rtow/renderer.hpp"
+
+namespace rtow {
+
+/// Time items spent in one stage of the pipeline, from being picked up to being handed on (including
+/// any wait for room in the next queue).
+struct StageStats {
+  size_t items = 0;
+  double busy_ms = 0.;  // summed over items, so it can exceed the wall time of a parallel stage
+  double max_ms = 0.;
+
+  double mean_ms() const { return items > 0 ? busy_ms / static_cast<double>(items) : 0.; }
+
+  void add(const double ms) {
+    ++items;
+    busy_ms += ms;
+    max_ms = std::max(max_ms, ms);
+  }
+};
+
+struct PipelineStats {
+  StageStats render;        // per tile, on the thread pool
+  StageStats post_process;  // per tile: exposure, tone map, encoding to 8 bits
+  StageStats encode;        // per band of tile rows: PPM text
+  StageStats write;         // per band: output stream
+  double render_wall_ms = 0.;  // until the last tile was rendered
+  double wall_ms = 0.;         // until the last byte was written
+  double drain_ms() const { return wall_ms - render_wall_ms; }  // output time not hidden behind rendering
+};
+
+/// Renders a width x height frame tile by tile and streams it to 'out' as PPM while rendering continues.
+/// Finished tiles flow through bounded queues of 'queue_depth' items to a post-process thread (averaging
+/// over 'spp', tone map and 8-bit encoding), then, once a full band of tile rows is complete, to an
+/// encoder thread and a writer thread. A full queue blocks the stage feeding it, so a slow output
+/// throttles rendering instead of piling up tiles. The bytes are those of post_process then to_ppm.
+template <typename T>
+PipelineStats render_pipelined(const Renderer<T>& renderer, const size_t width, const size_t height,
+                               const size_t spp, const PostProcessSettings& display, std::ostream& out,
+                               const size_t queue_depth = 8) {
+  using Clock = std::chrono::steady_clock;
+  const auto elapsed_ms = [](const Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  };
+
+  struct Tile {
+    size_t u0 = 0;
+    size_t v0 = 0;
+    Image radiance = {0, 0, PIXEL_FORMAT::UNKNOWN};
+    Image8 pixels;
+  };
+  struct Band {
+    std::string text;
+  };
+
+  PipelineStats stats;
+  std::mutex render_stats_mutex;
+  BoundedQueue<Tile> rendered(queue_depth);
+  BoundedQueue<Tile> processed(queue_depth);
+  BoundedQueue<Band> encoded(queue_depth);
+
+  const size_t tile_size = renderer.settings().tile_size;
+  const size_t tiles_u = (width + tile_size - 1) / tile_size;
+  const size_t tiles_v = (height + tile_size - 1) / tile_size;
+
+  out << "P3\n" << width << " " << height << "\n255\n";
+  const auto start = Clock::now();
+
+  std::thread post_process_thread([&] {
+    Tile tile;
+    while (rendered.pop(tile)) {
+      const auto stage_start = Clock::now();
+      post_process(tile.radiance, spp, display, tile.pixels);
+      tile.radiance = Image(0, 0, PIXEL_FORMAT::UNKNOWN);
+      processed.push(std::move(tile));
+      stats.post_process.add(elapsed_ms(stage_start));
+    }
+  });
+
+  std::thread encode_thread([&] {
+    // tiles arrive out of order; a band of tile rows is encoded once all of its tiles are in
+    std::vector<uint8_t> frame(width * height * 3);
+    std::vector<size_t> tiles_in_band(tiles_v, 0);
+    size_t next_band = 0;
+    Tile tile;
+    while (processed.pop(tile)) {
+      const auto stage_start = Clock::now();
+      for (size_t v = 0; v < tile.pixels.height; ++v) {
+        std::copy_n(tile.pixels.rgb.data() + v * tile.pixels.width * 3, tile.pixels.width * 3,
+                    frame.data() + ((tile.v0 + v) * width + tile.u0) * 3);
+      }
+      ++tiles_in_band[tile.v0 / tile_size];
+
+      for (; next_band < tiles_v && tiles_in_band[next_band] == tiles_u; ++next_band) {
+        const size_t v0 = next_band * tile_size;
+        const size_t rows = std::min(tile_size, height - v0);
+        std::ostringstream text;
+        to_ppm(frame.data() + v0 * width * 3, width, rows, text, false);
+        const auto band_start = Clock::now();
+        encoded.push({std::move(text).str()});
+        stats.encode.add(std::chrono::duration<double, std::milli>(band_start - stage_start).count());
+      }
+    }
+    encoded.close();
+  });
+
+  std::thread write_thread([&] {
+    Band band;
+    while (encoded.pop(band)) {
+      const auto stage_start = Clock::now();
+      out.write(band.text.data(), static_cast<std::streamsize>(band.text.size()));
+      stats.write.add(elapsed_ms(stage_start));
+    }
+    out.flush();
+  });
+
+  renderer.for_each_tile(width, height, tile_size, [&](const size_t u0, const size_t v0, const size_t u1,
+                                                       const size_t v1) {
+    const auto stage_start = Clock::now();
+    Tile tile = {u0, v0, {u1 - u0, v1 - v0, PIXEL_FORMAT::RGB}, {}};
+    tile.radiance.alloc();
+
+    const auto visible = renderer.tile_scene(u0, v0, u1, v1);
+    for (size_t v = v0; v < v1; ++v) {
+      for (size_t u = u0; u < u1; ++u) {
+        color& sum = tile.radiance.at(u - u0, v - v0);
+        for (size_t k = 0; k < spp; ++k) {
+          renderer.add_sample(sum, u, v, k, visible.get());
+        }
+      }
+    }
+    rendered.push(std::move(tile));
+
+    const double ms = elapsed_ms(stage_start);
+    std::lock_guard<std::mutex> lock(render_stats_mutex);
+    stats.render.add(ms);
+  });
+  stats.render_wall_ms = elapsed_ms(start);
+
+  rendered.close();
+  post_process_thread.join();
+  processed.close();
+  encode_thread.join();
+  write_thread.join();
+  stats.wall_ms = elapsed_ms(start);
+  return stats;
+}
+
+}  // namespace rtow
@@ -92,19 +92,16 @@ Mat4<T> Pose2T(const T* xyzpqr) {
   return Pose2T(xyzpqr[0], xyzpqr[1], xyzpqr[2], xyzpqr[3], xyzpqr[4], xyzpqr[5]);
 }
 
+/// Rotation block of a homogeneous transform.
+template <typename T>
+Mat3<T> T2R(const Mat4<T>& Tab) {
+  return {{Tab(0, 0), Tab(0, 1), Tab(0, 2), Tab(1, 0), Tab(1, 1), Tab(1, 2), Tab(2, 0), Tab(2, 1), Tab(2, 2)}};
+}
+
 /// Convert from matrix to vector form.
 template <typename T>
 pose<T> T2Pose(const Mat4<T>& Tab) {
-  const Mat3<T> R =
-      // clang-format off
-  {{
-    Tab(0, 0), Tab(0, 1), Tab(0, 2),
-    Tab(1, 0), Tab(1, 1), Tab(1, 2),
-    Tab(2, 0), Tab(2, 1), Tab(2, 2) 
-  }};
-  // clang-format on
-
-  const auto pqr = EulerZYX(R);
+  const auto pqr = EulerZYX(T2R(Tab));
   return {{Tab(0, 3), Tab(1, 3), Tab(2, 3), pqr[0], pqr[1], pqr[2]}};
 }
 
@@ -149,7 +146,7 @@ pose<T> TInv(const pose<T>& tab) {
   const Mat3<T> RT = transpose(R);
   const Vec3<T> pqr = EulerZYX(RT);
   const Vec3<T> xyz = -RT * position(tab);
-  return {xyz[0], xyz[1], xyz[2], pqr[0], pqr[1], pqr[2]};
+  return {{xyz[0], xyz[1], xyz[2], pqr[0], pqr[1], pqr[2]}};
 }
 
 /// Transform a point by a transformation.
@@ -218,7 +215,7 @@ Vec3<T> TransformDir(const Mat3<T>& R, const Vec3<T>& xap) {
 /// Transform a direction vector (i.e. rotation only) by the rotation of Tab.
 template <typename T>
 Vec3<T> TransformDir(const Mat4<T>& Tab, const Vec3<T>& xap) {
-  return Pose2R(T2Pose(Tab)) * xap;
+  return T2R(Tab) * xap;
 }
 
 /// Transform a direction vector (i.e. rotation only) by the rotation of tab.
@@ -236,7 +233,8 @@ Vec3<T> InvTransform(const pose<T>& tab, const Vec3<T>& p) {
 // Transform a point by the inverse of T.
 template <typename T>
 Vec3<T> InvTransform(const Mat4<T>& Tab, const Vec3<T>& p) {
-  return InvTransform(T2Pose(Tab), p);
+  const Vec3<T> t = {Tab(0, 3), Tab(1, 3), Tab(2, 3)};
+  return transpose(T2R(Tab)) * (p - t);
 }
 
 // Check if this pose has been marked as invalid by setting the X component of
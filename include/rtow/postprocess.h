@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "rtow/image.h"
+#include "rtow/simd.h"
+
+namespace rtow {
+
+/// Display transform applied to a finished accumulator. The defaults (no exposure, clamp, gamma 2.5)
+/// reproduce resolve followed by to_ppm exactly.
+struct PostProcessSettings {
+  float exposure = 0.F;  // in stops
+  ToneMap tone_map = ToneMap::CLAMP;
+  TransferFunction transfer = TransferFunction::GAMMA;
+  float gamma = 2.5F;  // used by TransferFunction::GAMMA
+};
+
+/// Accepts "clamp", "reinhard" and "aces".
+bool parse_tone_map(const std::string& name, ToneMap& tone_map);
+
+/// 8-bit interleaved RGB, ready for the encoders.
+struct Image8 {
+  size_t width = 0;
+  size_t height = 0;
+  std::vector<uint8_t> rgb;
+};
+
+/// Averages an image of per-pixel radiance sums over 'samples_per_pixel', exposes, tone maps and encodes
+/// it into 'out' (resized as needed), one fused vectorized pass per row.
+void post_process(const Image& accumulator, size_t samples_per_pixel, const PostProcessSettings& settings, Image8& out);
+
+void to_ppm(const Image8& image, std::ostream& out, bool write_header = true);
+
+/// Reads a P3 or P6 PPM with a maxval of 255. Returns false if the file can't be read or is malformed.
+bool read_ppm(const std::string& path, Image8& out);
+
+}  // namespace rtow
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <cmath>
+
+#include "rtow/pose.hpp"
+#include "rtow/rigid_transform.hpp"
+
+namespace rtow {
+
+/// Rotation quaternion w + xi + yj + zk (Hamilton convention). Rotations are expected to be unit length;
+/// normalized() restores that after long chains of products.
+template <typename T = float>
+struct Quaternion {
+  T w = T(1);
+  T x = T(0);
+  T y = T(0);
+  T z = T(0);
+
+  /// Same rotation as Pose2R(p, q, r), i.e. Rz(r) * Ry(q) * Rx(p), without building the matrix.
+  static Quaternion from_euler(const T p, const T q, const T r) {
+    const T cr = cos(p * T(0.5));
+    const T sr = sin(p * T(0.5));
+    const T cp = cos(q * T(0.5));
+    const T sp = sin(q * T(0.5));
+    const T cy = cos(r * T(0.5));
+    const T sy = sin(r * T(0.5));
+    return {cr * cp * cy + sr * sp * sy, sr * cp * cy - cr * sp * sy, cr * sp * cy + sr * cp * sy,
+            cr * cp * sy - sr * sp * cy};
+  }
+
+  /// Quaternion of an orthonormal rotation matrix (Shepperd's method: divides by the largest of the
+  /// four candidates, so it is stable for every rotation).
+  static Quaternion from_rotation(const Mat3<T>& R) {
+    const T r00 = R(0, 0), r01 = R(0, 1), r02 = R(0, 2);
+    const T r10 = R(1, 0), r11 = R(1, 1), r12 = R(1, 2);
+    const T r20 = R(2, 0), r21 = R(2, 1), r22 = R(2, 2);
+    const T trace = r00 + r11 + r22;
+    Quaternion q;
+    if (trace > T(0)) {
+      const T s = std::sqrt(trace + T(1)) * T(2);
+      q = {T(0.25) * s, (r21 - r12) / s, (r02 - r20) / s, (r10 - r01) / s};
+    } else if (r00 > r11 && r00 > r22) {
+      const T s = std::sqrt(T(1) + r00 - r11 - r22) * T(2);
+      q = {(r21 - r12) / s, T(0.25) * s, (r01 + r10) / s, (r02 + r20) / s};
+    } else if (r11 > r22) {
+      const T s = std::sqrt(T(1) + r11 - r00 - r22) * T(2);
+      q = {(r02 - r20) / s, (r01 + r10) / s, T(0.25) * s, (r12 + r21) / s};
+    } else {
+      const T s = std::sqrt(T(1) + r22 - r00 - r11) * T(2);
+      q = {(r10 - r01) / s, (r02 + r20) / s, (r12 + r21) / s, T(0.25) * s};
+    }
+    return q.normalized();
+  }
+
+  Mat3<T> to_rotation() const {
+    const T xx = x * x, yy = y * y, zz = z * z;
+    const T xy = x * y, xz = x * z, yz = y * z;
+    const T wx = w * x, wy = w * y, wz = w * z;
+    // clang-format off
+    return {{T(1) - T(2) * (yy + zz),        T(2) * (xy - wz),        T(2) * (xz + wy),
+                    T(2) * (xy + wz), T(1) - T(2) * (xx + zz),        T(2) * (yz - wx),
+                    T(2) * (xz - wy),        T(2) * (yz + wx), T(1) - T(2) * (xx + yy)}};
+    // clang-format on
+  }
+
+  T dot(const Quaternion& b) const { return w * b.w + x * b.x + y * b.y + z * b.z; }
+
+  Quaternion normalized() const {
+    const T inv_norm = T(1) / std::sqrt(dot(*this));
+    return {w * inv_norm, x * inv_norm, y * inv_norm, z * inv_norm};
+  }
+
+  /// Inverse of a unit quaternion.
+  Quaternion conjugate() const { return {w, -x, -y, -z}; }
+
+  /// Rotation by 'b' followed by rotation by *this.
+  Quaternion operator*(const Quaternion& b) const {
+    return {w * b.w - x * b.x - y * b.y - z * b.z, w * b.x + x * b.w + y * b.z - z * b.y,
+            w * b.y - x * b.z + y * b.w + z * b.x, w * b.z + x * b.y - y * b.x + z * b.w};
+  }
+
+  /// Rotates 'v': v + w * t + u x t with t = 2 * (u x v), u = (x, y, z).
+  Vec3<T> rotate(const Vec3<T>& v) const {
+    const T tx = T(2) * (y * v[2] - z * v[1]);
+    const T ty = T(2) * (z * v[0] - x * v[2]);
+    const T tz = T(2) * (x * v[1] - y * v[0]);
+    return {v[0] + w * tx + (y * tz - z * ty), v[1] + w * ty + (z * tx - x * tz), v[2] + w * tz + (x * ty - y * tx)};
+  }
+};
+
+/// Spherical linear interpolation along the shorter arc, constant angular velocity in 's'.
+template <typename T>
+Quaternion<T> slerp(const Quaternion<T>& a, Quaternion<T> b, const T s) {
+  T cos_theta = a.dot(b);
+  if (cos_theta < T(0)) {
+    b = {-b.w, -b.x, -b.y, -b.z};
+    cos_theta = -cos_theta;
+  }
+
+  T wa = T(1) - s;
+  T wb = s;
+  // nearly parallel: sin(theta) vanishes, and linear interpolation is exact to rounding
+  if (cos_theta < T(0.9995)) {
+    const T theta = std::acos(cos_theta);
+    const T inv_sin = T(1) / std::sin(theta);
+    wa = std::sin((T(1) - s) * theta) * inv_sin;
+    wb = std::sin(s * theta) * inv_sin;
+  }
+  return Quaternion<T>{wa * a.w + wb * b.w, wa * a.x + wb * b.x, wa * a.y + wb * b.y, wa * a.z + wb * b.z}
+      .normalized();
+}
+
+/// Rotation (unit quaternion) and translation of frame 'b' in frame 'a', x_a = q * x_b + t. Composition
+/// is a quaternion product plus one rotated vector, with no trig and no Euler extraction, and is free of
+/// the gimbal-lock loss TComp(pose, pose) has near +/-90 degrees of pitch.
+template <typename T = float>
+class QuatTransform {
+public:
+  QuatTransform()
+      : t_(T(0)) {}
+
+  QuatTransform(const Quaternion<T>& q, const Vec3<T>& t)
+      : q_(q)
+      , t_(t) {}
+
+  explicit QuatTransform(const pose<T>& tab)
+      : q_(Quaternion<T>::from_euler(tab[3], tab[4], tab[5]))
+      , t_(position(tab)) {}
+
+  explicit QuatTransform(const Mat4<T>& Tab)
+      : q_(Quaternion<T>::from_rotation(T2R(Tab)))
+      , t_{{Tab(0, 3), Tab(1, 3), Tab(2, 3)}} {}
+
+  explicit QuatTransform(const RigidTransform<T>& Tab)
+      : q_(Quaternion<T>::from_rotation(Tab.rotation()))
+      , t_(Tab.translation()) {}
+
+  const Quaternion<T>& rotation() const { return q_; }
+  const Vec3<T>& translation() const { return t_; }
+
+  pose<T> to_pose() const {
+    const Vec3<T> pqr = EulerZYX(q_.to_rotation());
+    return {{t_[0], t_[1], t_[2], pqr[0], pqr[1], pqr[2]}};
+  }
+
+  Mat4<T> to_matrix() const { return to_rigid().to_matrix(); }
+  RigidTransform<T> to_rigid() const { return {q_.to_rotation(), t_}; }
+
+  QuatTransform inverse() const {
+    const Quaternion<T> q_inv = q_.conjugate();
+    return {q_inv, -q_inv.rotate(t_)};
+  }
+
+  /// T_ac = T_ab * T_bc. The product is renormalized so long chains stay rigid.
+  QuatTransform operator*(const QuatTransform& bc) const { return {(q_ * bc.q_).normalized(), q_.rotate(bc.t_) + t_}; }
+
+  Vec3<T> transform_point(const Vec3<T>& p) const { return q_.rotate(p) + t_; }
+  Vec3<T> transform_dir(const Vec3<T>& d) const { return q_.rotate(d); }
+
+private:
+  Quaternion<T> q_;
+  Vec3<T> t_;
+};
+
+/// Rotation by slerp, translation linear; s = 0 gives 'a', s = 1 gives 'b'.
+template <typename T>
+QuatTransform<T> interpolate(const QuatTransform<T>& a, const QuatTransform<T>& b, const T s) {
+  return {slerp(a.rotation(), b.rotation(), s), a.translation() + (b.translation() - a.translation()) * s};
+}
+
+}  // namespace rtow
@@ -7,18 +7,30 @@ template <typename T>
 class Ray {
 public:
   Ray() = default;
-  Ray(const Vec3<T>& origin, const Vec3<T>& direction)
+  Ray(const Vec3<T>& origin, const Vec3<T>& direction, const T width = T(0), const T spread = T(0))
       : origin_(origin)
-      , direction_(direction) {}
+      , direction_(direction)
+      , width_(width)
+      , spread_(spread) {}
 
   const Vec3<T>& origin() const { return origin_; }
   const Vec3<T>& direction() const { return direction_; }
 
   Vec3<T> at(const T t) const { return origin_ + direction_ * t; }
 
+  /// The ray is the axis of a cone 'width' wide at the origin, widening by 'spread' per unit of distance
+  /// (a ray cone, used to pick texture detail). Zero for both is an infinitely thin ray.
+  T width() const { return width_; }
+  T spread() const { return spread_; }
+
+  /// Width of the cone at 'at(t)'.
+  T cone_width(const T t) const { return width_ + spread_ * t * direction_.norm(); }
+
 private:
   Vec3<T> origin_ = {Vec3<T>::NaN};
   Vec3<T> direction_ = {Vec3<T>::NaN};
+  T width_ = T(0);
+  T spread_ = T(0);
 };
 
 using Rayf = Ray<float>;
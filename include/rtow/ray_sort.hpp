@@ -0,0 +1,102 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "rtow/ray.hpp"
+
+namespace rtow {
+
+/// Spreads the low 10 bits of 'v' so that there are two zero bits between each of them.
+inline uint32_t expand_bits_10(uint32_t v) {
+  v &= 0x3FFU;
+  v = (v | (v << 16)) & 0x030000FFU;
+  v = (v | (v << 8)) & 0x0300F00FU;
+  v = (v | (v << 4)) & 0x030C30C3U;
+  v = (v | (v << 2)) & 0x09249249U;
+  return v;
+}
+
+/// 30-bit Morton code of a point with coordinates in [0, 1].
+template <typename T>
+inline uint32_t morton_code(const T x, const T y, const T z) {
+  const auto quantize = [](const T c) {
+    return static_cast<uint32_t>(std::clamp(c * T(1024), T(0), T(1023)));
+  };
+  return (expand_bits_10(quantize(x)) << 2) | (expand_bits_10(quantize(y)) << 1) | expand_bits_10(quantize(z));
+}
+
+/// Orders a batch of rays so that rays heading into the same direction octant from nearby origins are
+/// traced one after another. Keys are the direction octant (3 bits) above the Morton code of the origin,
+/// quantized within the batch's bounding box.
+template <typename T>
+class RaySorter {
+public:
+  /// Returns the indices in 'active' in traversal order; ray_of(i) yields the ray with index i.
+  template <typename RayOf>
+  const std::vector<uint32_t>& sort(const std::vector<uint32_t>& active, RayOf&& ray_of) {
+    Vec3<T> lo(std::numeric_limits<T>::max());
+    Vec3<T> hi(std::numeric_limits<T>::lowest());
+    for (const uint32_t i : active) {
+      const Vec3<T>& o = ray_of(i).origin();
+      for (size_t k = 0; k < 3; ++k) {
+        lo[k] = std::min(lo[k], o[k]);
+        hi[k] = std::max(hi[k], o[k]);
+      }
+    }
+    Vec3<T> scale;
+    for (size_t k = 0; k < 3; ++k) {
+      scale[k] = hi[k] > lo[k] ? T(1) / (hi[k] - lo[k]) : T(0);
+    }
+
+    keys_.clear();
+    keys_.reserve(active.size());
+    for (const uint32_t i : active) {
+      const Vec3<T>& o = ray_of(i).origin();
+      const Vec3<T>& d = ray_of(i).direction();
+      const uint64_t octant = (d.x() < T(0) ? 4U : 0U) | (d.y() < T(0) ? 2U : 0U) | (d.z() < T(0) ? 1U : 0U);
+      const uint32_t morton =
+          morton_code((o.x() - lo.x()) * scale.x(), (o.y() - lo.y()) * scale.y(), (o.z() - lo.z()) * scale.z());
+      keys_.emplace_back((octant << 30) | morton, i);
+    }
+    radix_sort();
+
+    order_.resize(keys_.size());
+    for (size_t k = 0; k < keys_.size(); ++k) {
+      order_[k] = keys_[k].second;
+    }
+    return order_;
+  }
+
+private:
+  static constexpr size_t kKeyBits = 33;  // octant + 30-bit Morton code
+  static constexpr size_t kDigitBits = 11;
+
+  // LSD radix sort of keys_ on kKeyBits, three counting passes
+  void radix_sort() {
+    scratch_.resize(keys_.size());
+    for (size_t shift = 0; shift < kKeyBits; shift += kDigitBits) {
+      std::array<uint32_t, (1U << kDigitBits) + 1> offsets = {};
+      for (const auto& key : keys_) {
+        ++offsets[((key.first >> shift) & ((1U << kDigitBits) - 1)) + 1];
+      }
+      for (size_t d = 1; d < offsets.size(); ++d) {
+        offsets[d] += offsets[d - 1];
+      }
+      for (const auto& key : keys_) {
+        scratch_[offsets[(key.first >> shift) & ((1U << kDigitBits) - 1)]++] = key;
+      }
+      std::swap(keys_, scratch_);
+    }
+  }
+
+  std::vector<std::pair<uint64_t, uint32_t>> keys_;
+  std::vector<std::pair<uint64_t, uint32_t>> scratch_;
+  std::vector<uint32_t> order_;
+};
+
+}  // namespace rtow
@@ -0,0 +1,96 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+
+#include "rtow/hittable.hpp"
+#include "rtow/integrator.hpp"
+#include "rtow/light.hpp"
+#include "rtow/pose.hpp"
+#include "rtow/postprocess.h"
+#include "rtow/thread_pool.h"
+
+namespace rtow {
+
+/// One job for the render server. On the wire it is a single line of space-separated key=value pairs
+/// after the word "render", e.g.
+///   render scene=spheres width=320 height=240 spp=16 eye=0,-1.5,-1.8 at=0,0,0
+/// 'pose=x,y,z,p,q,r' may be given instead of eye/at/up, and 'exposure=<stops>', 'tonemap=<name>' and
+/// 'transfer=gamma|srgb' set the display transform. Unset keys keep the defaults below.
+struct RenderRequest {
+  std::string scene;
+  size_t width = 160;
+  size_t height = 128;
+  size_t samples_per_pixel = 16;
+  size_t max_ray_bounces = 10;
+  IntegratorType integrator = IntegratorType::PATH;
+  pose<float> pose_world_camera = pose<float>(0.F);
+  PostProcessSettings display;
+};
+
+/// Parses the text after "render"; on failure 'error' says which pair was rejected.
+bool parse_render_request(const std::string& text, RenderRequest& request, std::string& error);
+
+/// Long-running renderer that keeps named scenes resident and serves render requests over a Unix-domain
+/// socket, so that a job pays for neither process startup nor scene construction. Every connection is
+/// served on its own thread; their jobs run concurrently on one shared thread pool.
+///
+/// Protocol: the client sends one command per line and gets, per command, either "ok <n>\n" followed by n
+/// bytes of payload, or "error <message>\n". Commands are "render ..." (payload: a PPM image) and
+/// "scenes" (payload: the resident scene names, one per line).
+class RenderServer {
+public:
+  explicit RenderServer(ThreadPool& pool, std::ostream& log = std::cout);
+  ~RenderServer();
+
+  RenderServer(const RenderServer&) = delete;
+  RenderServer& operator=(const RenderServer&) = delete;
+
+  /// Makes a scene available to requests under 'name'. Scenes must not change while the server runs.
+  void add_scene(const std::string& name, std::shared_ptr<const Hittable<float>> world,
+                 std::shared_ptr<const LightList<float>> lights);
+
+  /// Binds 'socket_path' (replacing a stale socket file) and accepts connections until stop().
+  /// Returns false if the socket could not be set up.
+  bool serve(const std::string& socket_path);
+
+  /// Stops accepting, disconnects clients once their current job is done and waits for them to close.
+  void stop();
+
+  /// Renders 'request' into a PPM image in 'ppm'. Used by the connections, and usable in-process.
+  bool render(const RenderRequest& request, std::string& ppm, std::string& error) const;
+
+  size_t jobs_completed() const { return jobs_completed_.load(); }
+
+private:
+  struct Scene {
+    std::shared_ptr<const Hittable<float>> world;
+    std::shared_ptr<const LightList<float>> lights;
+  };
+
+  void handle_connection(int fd);
+  std::string handle_command(const std::string& line, std::string& payload) const;
+
+  ThreadPool& pool_;
+  std::ostream& log_;
+  std::map<std::string, Scene> scenes_;
+
+  std::atomic<int> listen_fd_ = -1;
+  std::atomic<bool> stopping_ = false;
+  std::mutex connections_mutex_;
+  std::set<int> connection_fds_;
+  std::condition_variable connections_done_;
+  mutable std::atomic<size_t> jobs_completed_ = 0;
+};
+
+/// Client side: sends one command line to the server at 'socket_path' and reads the reply payload.
+/// Returns false on connection errors or an "error" reply, whose message ends up in 'error'.
+bool render_server_request(const std::string& socket_path, const std::string& command, std::string& payload,
+                           std::string& error);
+
+}  // namespace rtow
@@ -0,0 +1,305 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "rtow/camera.hpp"
+#include "rtow/frustum.hpp"
+#include "rtow/hittable.hpp"
+#include "rtow/image.h"
+#include "rtow/integrator.hpp"
+#include "rtow/light.hpp"
+#include "rtow/pose.hpp"
+#include "rtow/rigid_transform.hpp"
+#include "rtow/thread_pool.h"
+#include "rtow/utils.hpp"
+
+namespace rtow {
+
+struct RenderSettings {
+  size_t samples_per_pixel = 16;
+  size_t max_ray_bounces = 10;
+  size_t tile_size = 16;
+
+  IntegratorType integrator = IntegratorType::PATH;
+  size_t ao_rays = 4;        // AMBIENT_OCCLUSION: short rays per camera sample
+  float ao_radius = 0.5F;    // AMBIENT_OCCLUSION: occluders further away than this are ignored
+  float depth_range = 5.F;   // DEPTH: distance mapped to black
+
+  uint64_t seed = 0;  // base of the per-sample random sequences
+  bool cull_tiles = true;  // trace each tile's camera rays against the primitives in its frustum only
+  bool replicate_scene = false;  // NUMA pools: give each node its own node-local copy of the world
+};
+
+/// Renders a scene, as seen by a posed camera, into an accumulation buffer of radiance sums. Work is split
+/// into square tiles that are distributed over a thread pool.
+template <typename T = float>
+class Renderer {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  Renderer(const Camera<T>& camera, const pose<T>& pose_world_camera, const Hittable<T>& world,
+           const LightList<T>& lights, ThreadPool& pool, const RenderSettings& settings = {})
+      : camera_(camera)
+      , world_(world)
+      , lights_(lights)
+      , pool_(pool)
+      , settings_(settings)
+      , T_world_camera_(pose_world_camera) {
+    if (settings_.replicate_scene && pool_.num_nodes() > 1) {
+      // copied by a thread on each node so the copy's pages live there; worlds that can't be copied
+      // (replicate is not implemented) stay shared
+      replicas_.resize(pool_.num_nodes());
+      for (size_t node = 0; node < replicas_.size(); ++node) {
+        pool_.run_on_node(node, [&] { replicas_[node] = world_.replicate(); });
+      }
+      if (std::find(replicas_.begin(), replicas_.end(), nullptr) != replicas_.end()) replicas_.clear();
+    }
+  }
+
+  const RenderSettings& settings() const { return settings_; }
+
+  const Camera<T>& camera() const { return camera_; }
+  const Hittable<T>& world() const { return world_; }
+
+  /// The world as the calling thread should trace it: its node's replica if the scene is replicated.
+  const Hittable<T>& scene() const {
+    const size_t node = ThreadPool::current_node();
+    return node < replicas_.size() ? *replicas_[node] : world_;
+  }
+  const LightList<T>& lights() const { return lights_; }
+
+  /// Allocates 'image' zeroed, tile by tile on the thread pool in the order render_pass hands out tiles. On
+  /// a NUMA pool each page is then first touched, and so placed, on the node that will render it.
+  bool alloc(Image& image) const {
+    if (!image.alloc_uninitialized()) return false;
+    for_each_tile(image.width(), image.height(), settings_.tile_size,
+                  [&](const size_t u0, const size_t v0, const size_t u1, const size_t v1) {
+                    for (size_t v = v0; v < v1; ++v) {
+                      std::fill_n(&image.at(u0, v), u1 - u0, color::constant(0.));
+                    }
+                  });
+    return true;
+  }
+
+  void set_pose(const pose<T>& pose_world_camera) {
+    T_world_camera_ = RigidTransform<T>(pose_world_camera);
+    invalidate_tile_scenes();
+  }
+
+  /// Drops the cached tile_scene subsets; call it after changing the world (e.g. moving BVH instances).
+  void invalidate_tile_scenes() {
+    std::lock_guard<std::mutex> lock(tile_scenes_mutex_);
+    tile_scenes_.clear();
+  }
+
+  /// Calls fn(u0, v0, u1, v1) for every 'tile' x 'tile' block of a width x height frame on the thread pool.
+  template <typename Fn>
+  void for_each_tile(const size_t width, const size_t height, const size_t tile, Fn&& fn) const {
+    const size_t tiles_u = (width + tile - 1) / tile;
+    const size_t tiles_v = (height + tile - 1) / tile;
+
+    pool_.parallel_for(tiles_u * tiles_v, [&](const size_t index) {
+      const size_t u0 = (index % tiles_u) * tile;
+      const size_t v0 = (index / tiles_u) * tile;
+      fn(u0, v0, std::min(u0 + tile, width), std::min(v0 + tile, height));
+    });
+  }
+
+  /// Calls fn(u, v) for every pixel of a width x height frame, tile by tile on the thread pool.
+  template <typename Fn>
+  void for_each_pixel(const size_t width, const size_t height, Fn&& fn) const {
+    for_each_tile(width, height, settings_.tile_size,
+                  [&](const size_t u0, const size_t v0, const size_t u1, const size_t v1) {
+                    for (size_t v = v0; v < v1; ++v) {
+                      for (size_t u = u0; u < u1; ++u) {
+                        fn(u, v);
+                      }
+                    }
+                  });
+  }
+
+  /// Adds samples [first_sample, first_sample + spp) to every pixel of 'accumulator'. The accumulator may
+  /// hold just a band of the frame, whose first row is frame row 'row_offset'. Samples are added one by
+  /// one in sample order, so the sums don't depend on how the samples were split into passes either.
+  void render_pass(Image& accumulator, const size_t spp, const size_t row_offset = 0,
+                   const size_t first_sample = 0) const {
+    for_each_tile(accumulator.width(), accumulator.height(), settings_.tile_size,
+                  [&](const size_t u0, const size_t v0, const size_t u1, const size_t v1) {
+                    render_tile(accumulator, u0, v0, u1, v1, spp, row_offset, first_sample);
+                  });
+  }
+
+  /// render_pass restricted to the pixels [u0, u1) x [v0, v1) of 'accumulator'.
+  void render_tile(Image& accumulator, const size_t u0, const size_t v0, const size_t u1, const size_t v1,
+                   const size_t spp, const size_t row_offset = 0, const size_t first_sample = 0) const {
+    // a band is rendered once, and keeping its tiles' subsets would leave those of every band resident,
+    // which is the memory streaming a frame band by band avoids
+    const bool band = row_offset != 0 || static_cast<T>(accumulator.height()) < camera_.height();
+    const auto visible = tile_scene(u0, v0 + row_offset, u1, v1 + row_offset, !band);
+    for (size_t v = v0; v < v1; ++v) {
+      for (size_t u = u0; u < u1; ++u) {
+        color& sum = accumulator.at(u, v);
+        for (size_t k = first_sample; k < first_sample + spp; ++k) {
+          add_sample(sum, u, v + row_offset, k, visible.get());
+        }
+      }
+    }
+  }
+
+  /// Frustum of the camera rays through the pixels [u0, u1) x [v0, v1), jitter included.
+  TileFrustum<T> tile_frustum(const size_t u0, const size_t v0, const size_t u1, const size_t v1) const {
+    return {camera_, T_world_camera_, static_cast<T>(u0), static_cast<T>(v0), static_cast<T>(u1), static_cast<T>(v1)};
+  }
+
+  /// The part of the world that camera rays through the pixels [u0, u1) x [v0, v1) can hit first, or null
+  /// if culling is off or the world can't be culled. Hits against it are exactly those against the world.
+  /// With 'cache', each tile is culled once and reused by later passes until the pose changes.
+  std::shared_ptr<const Hittable<T>> tile_scene(const size_t u0, const size_t v0, const size_t u1, const size_t v1,
+                                                const bool cache = true) const {
+    if (!settings_.cull_tiles) return nullptr;
+    const TileFrustum<T> frustum = tile_frustum(u0, v0, u1, v1);
+    const auto cull = [&] {
+      return scene().cull([&](const Vec3<T>& center, const T radius) { return frustum.overlaps(center, radius); });
+    };
+    if (!cache) return cull();
+
+    const TileKey key = {u0, v0, u1, v1, replicas_.empty() ? 0 : ThreadPool::current_node()};
+    {
+      std::lock_guard<std::mutex> lock(tile_scenes_mutex_);
+      const auto cached = tile_scenes_.find(key);
+      if (cached != tile_scenes_.end()) return cached->second;
+    }
+
+    // culled outside the lock; should two threads race on a tile, the first subset is kept
+    auto visible = cull();
+    std::lock_guard<std::mutex> lock(tile_scenes_mutex_);
+    return tile_scenes_.emplace(key, std::move(visible)).first->second;
+  }
+
+  /// Number of tile_scene subsets currently cached.
+  size_t cached_tile_scenes() const {
+    std::lock_guard<std::mutex> lock(tile_scenes_mutex_);
+    return tile_scenes_.size();
+  }
+
+  /// Runs passes of one sample per pixel into 'accumulator' until 'deadline', which is checked before every
+  /// tile, so it is overshot by at most one tile per thread; only the first pass always completes. Tiles the
+  /// last pass did not reach are scaled up to its sample count, so every pixel of 'accumulator' holds the
+  /// returned number of samples per pixel times its mean.
+  size_t render_until(Image& accumulator, const Clock::time_point deadline, const size_t max_spp = SIZE_MAX) const {
+    const size_t width = accumulator.width();
+    const size_t height = accumulator.height();
+    const size_t tile = settings_.tile_size;
+    const size_t tiles_u = (width + tile - 1) / tile;
+    std::vector<uint8_t> reached(tiles_u * ((height + tile - 1) / tile));
+
+    size_t spp = 0;
+    while (spp < max_spp && (spp == 0 || Clock::now() < deadline)) {
+      std::fill(reached.begin(), reached.end(), 0);
+      for_each_tile(width, height, tile, [&](const size_t u0, const size_t v0, const size_t u1, const size_t v1) {
+        if (spp > 0 && Clock::now() >= deadline) return;
+        render_tile(accumulator, u0, v0, u1, v1, 1, 0, spp);
+        reached[(v0 / tile) * tiles_u + u0 / tile] = 1;
+      });
+
+      const size_t tiles_reached = static_cast<size_t>(std::count(reached.begin(), reached.end(), 1));
+      if (tiles_reached == 0) break;
+      ++spp;
+      if (tiles_reached == reached.size()) continue;
+
+      // the deadline cut this pass short: the tiles it missed hold one sample less
+      const float scale = static_cast<float>(spp) / static_cast<float>(spp - 1);
+      for_each_tile(width, height, tile, [&](const size_t u0, const size_t v0, const size_t u1, const size_t v1) {
+        if (reached[(v0 / tile) * tiles_u + u0 / tile] != 0) return;
+        for (size_t v = v0; v < v1; ++v) {
+          for (size_t u = u0; u < u1; ++u) accumulator.at(u, v) *= scale;
+        }
+      });
+      break;
+    }
+
+    return spp;
+  }
+
+  /// Sum of samples [first_sample, first_sample + spp) through pixel (u, v).
+  color sample_pixel(const size_t u, const size_t v, const size_t spp, const size_t first_sample = 0) const {
+    color sum = {0.F};
+    for (size_t k = first_sample; k < first_sample + spp; ++k) {
+      add_sample(sum, u, v, k);
+    }
+    return sum;
+  }
+
+  /// Adds sample 'k' of pixel (u, v) to 'sum'. The sample draws from its own random sequence, seeded from
+  /// the pixel and the sample index, which makes it bit-identical whichever thread or process renders it.
+  /// 'visible' is the pixel's tile_scene, if any.
+  void add_sample(color& sum, const size_t u, const size_t v, const size_t k,
+                  const Hittable<T>* visible = nullptr) const {
+    seed_random(sample_seed(u, v, k));
+    const T eu = static_cast<T>(u) + random(T(0), T(1));
+    const T ev = static_cast<T>(v) + random(T(0), T(1));
+    const color sample = radiance(primary_ray(eu, ev), visible);
+    if (!sample.has_NaN()) sum += sample;
+  }
+
+  uint64_t sample_seed(const size_t u, const size_t v, const size_t k) const {
+    return mix64(settings_.seed ^ mix64((static_cast<uint64_t>(v) << 32U) | u) ^ mix64(k + 0x9E3779B97F4A7C15ULL));
+  }
+
+  /// Radiance (or preview value) carried back along a camera ray by the configured integrator. The first hit
+  /// is looked up in 'visible' when given.
+  color radiance(const Ray<T>& ray, const Hittable<T>* visible = nullptr) const {
+    const Hittable<T>& world = scene();
+    const Hittable<T>& first = visible != nullptr ? *visible : world;
+    switch (settings_.integrator) {
+      case IntegratorType::NORMALS:
+        return normals_color(ray, first);
+      case IntegratorType::DEPTH:
+        return depth_color(ray, first, static_cast<T>(settings_.depth_range));
+      case IntegratorType::AMBIENT_OCCLUSION:
+        return ambient_occlusion(ray, world, settings_.ao_rays, static_cast<T>(settings_.ao_radius), visible);
+      case IntegratorType::PATH:
+      case IntegratorType::UNKNOWN:
+      default:
+        return ray_color(ray, world, lights_, settings_.max_ray_bounces, visible);
+    }
+  }
+
+  /// Camera-to-world transform of the current pose.
+  const RigidTransform<T>& transform() const { return T_world_camera_; }
+  const Mat3<T>& rotation() const { return T_world_camera_.rotation(); }
+  const Vec3<T>& translation() const { return T_world_camera_.translation(); }
+
+  /// World-frame ray through the (sub-)pixel location (u, v).
+  Ray<T> primary_ray(const T u, const T v) const {
+    const Ray<T> ray_camera = camera_.unproject({u, v});
+    // a cone one pixel wide, for texture filtering
+    return {T_world_camera_.transform_point(ray_camera.origin()), T_world_camera_.transform_dir(ray_camera.direction()),
+            T(0), T(1) / camera_.fu()};
+  }
+
+private:
+  using TileKey = std::array<size_t, 5>;  // u0, v0, u1, v1 and the NUMA node of the culled replica
+
+  const Camera<T>& camera_;
+  const Hittable<T>& world_;
+  const LightList<T>& lights_;
+  ThreadPool& pool_;
+  RenderSettings settings_;
+  std::vector<std::shared_ptr<const Hittable<T>>> replicas_;  // per NUMA node, empty if not replicated
+
+  mutable std::mutex tile_scenes_mutex_;
+  mutable std::map<TileKey, std::shared_ptr<const Hittable<T>>> tile_scenes_;
+
+  // cached once so primary rays don't re-evaluate the Euler angles
+  RigidTransform<T> T_world_camera_;
+};
+
+}  // namespace rtow
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+
+#include "rtow/matrix_utils.hpp"
+#include "rtow/pose.hpp"
+#include "rtow/vec_utils.hpp"
+
+namespace rtow {
+
+/// Rotation and translation of frame 'b' in frame 'a', x_a = R * x_b + t. Unlike the Euler pose<T>, the
+/// rotation matrix is evaluated once, so transforming, inverting and composing cost no trig. pose<T> stays
+/// the interchange format; convert explicitly with the pose constructor and to_pose().
+template <typename T = float>
+class RigidTransform {
+public:
+  RigidTransform()
+      : R_{{T(1), T(0), T(0), T(0), T(1), T(0), T(0), T(0), T(1)}}
+      , t_(T(0)) {}
+
+  RigidTransform(const Mat3<T>& R, const Vec3<T>& t)
+      : R_(R)
+      , t_(t) {}
+
+  explicit RigidTransform(const pose<T>& tab)
+      : R_(Pose2R(tab))
+      , t_(position(tab)) {}
+
+  /// Takes the upper 3x4 block of a homogeneous transform.
+  explicit RigidTransform(const Mat4<T>& Tab)
+      : R_{{Tab(0, 0), Tab(0, 1), Tab(0, 2), Tab(1, 0), Tab(1, 1), Tab(1, 2), Tab(2, 0), Tab(2, 1), Tab(2, 2)}}
+      , t_{{Tab(0, 3), Tab(1, 3), Tab(2, 3)}} {}
+
+  const Mat3<T>& rotation() const { return R_; }
+  const Vec3<T>& translation() const { return t_; }
+
+  pose<T> to_pose() const {
+    const Vec3<T> pqr = EulerZYX(R_);
+    return {{t_[0], t_[1], t_[2], pqr[0], pqr[1], pqr[2]}};
+  }
+
+  Mat4<T> to_matrix() const {
+    // clang-format off
+    return {{R_(0, 0), R_(0, 1), R_(0, 2), t_[0],
+             R_(1, 0), R_(1, 1), R_(1, 2), t_[1],
+             R_(2, 0), R_(2, 1), R_(2, 2), t_[2],
+                 T(0),     T(0),     T(0),  T(1)}};
+    // clang-format on
+  }
+
+  /// Transform of 'a' in 'b'; exact for an orthonormal R.
+  RigidTransform inverse() const {
+    const Mat3<T> RT = transpose(R_);
+    return {RT, -(RT * t_)};
+  }
+
+  /// T_ac = T_ab * T_bc
+  RigidTransform operator*(const RigidTransform& bc) const { return {R_ * bc.R_, R_ * bc.t_ + t_}; }
+
+  Vec3<T> transform_point(const Vec3<T>& p) const { return R_ * p + t_; }
+  Vec3<T> transform_dir(const Vec3<T>& d) const { return R_ * d; }
+
+  /// Point in 'b' of a point 'p' given in 'a'.
+  Vec3<T> inverse_transform_point(const Vec3<T>& p) const { return transpose(R_) * (p - t_); }
+  Vec3<T> inverse_transform_dir(const Vec3<T>& d) const { return transpose(R_) * d; }
+
+  /// Transforms 'n' points stored as separate x, y and z arrays. Outputs may alias the inputs.
+  void transform_points(const T* x, const T* y, const T* z, T* out_x, T* out_y, T* out_z, const size_t n) const {
+    transform_arrays(x, y, z, out_x, out_y, out_z, n, t_[0], t_[1], t_[2]);
+  }
+
+  /// Rotates 'n' directions stored as separate x, y and z arrays. Outputs may alias the inputs.
+  void transform_dirs(const T* x, const T* y, const T* z, T* out_x, T* out_y, T* out_z, const size_t n) const {
+    transform_arrays(x, y, z, out_x, out_y, out_z, n, T(0), T(0), T(0));
+  }
+
+private:
+  void transform_arrays(const T* x, const T* y, const T* z, T* out_x, T* out_y, T* out_z, const size_t n,
+                        const T tx, const T ty, const T tz) const {
+    // coefficients in locals so the loop has no checked element access and vectorizes
+    const T r00 = R_(0, 0), r01 = R_(0, 1), r02 = R_(0, 2);
+    const T r10 = R_(1, 0), r11 = R_(1, 1), r12 = R_(1, 2);
+    const T r20 = R_(2, 0), r21 = R_(2, 1), r22 = R_(2, 2);
+    for (size_t i = 0; i < n; ++i) {
+      const T px = x[i];
+      const T py = y[i];
+      const T pz = z[i];
+      out_x[i] = r00 * px + r01 * py + r02 * pz + tx;
+      out_y[i] = r10 * px + r11 * py + r12 * pz + ty;
+      out_z[i] = r20 * px + r21 * py + r22 * pz + tz;
+    }
+  }
+
+  Mat3<T> R_;
+  Vec3<T> t_;
+};
+
+}  // namespace rtow
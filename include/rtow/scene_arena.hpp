@@ -0,0 +1,266 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#include "rtow/aabb.hpp"
+#include "rtow/hittable.hpp"
+#include "rtow/simd.h"
+#include "rtow/vec_utils.hpp"
+
+namespace rtow {
+
+/// Lightweight handles into a SceneArena.
+struct MaterialHandle {
+  uint32_t index = UINT32_MAX;
+};
+
+struct SphereHandle {
+  uint32_t index = UINT32_MAX;
+};
+
+/// Owns the scene's spheres in contiguous typed arrays (centers, radii and material indices, one array
+/// per field) that all live in a single aligned allocation. Unlike a HittableList of Spheres there is
+/// no per-object heap node, vtable pointer or material shared_ptr; materials are stored once and
+/// referenced by index.
+template <typename T = float>
+class SceneArena : public Hittable<T> {
+public:
+  SceneArena() = default;
+
+  MaterialHandle add_material(const std::shared_ptr<Material<T>>& material_ptr) {
+    // subsets made by cull() share the table; they keep the one they were made with
+    if (materials_.use_count() > 1) materials_ = std::make_shared<MaterialTable>(*materials_);
+    materials_->push_back(material_ptr);
+    return {static_cast<uint32_t>(materials_->size() - 1)};
+  }
+
+  SphereHandle add_sphere(const Vec3<T>& center, const T radius, const MaterialHandle material) {
+    if (size_ == capacity_) reserve(capacity_ > 0 ? 2 * capacity_ : kMinCapacity);
+
+    const size_t i = size_++;
+    cx_[i] = center.x();
+    cy_[i] = center.y();
+    cz_[i] = center.z();
+    r_[i] = radius;
+    material_[i] = material.index;
+    return {static_cast<uint32_t>(i)};
+  }
+
+  void reserve(const size_t capacity) {
+    if (capacity <= capacity_) return;
+
+    Block block(allocate(capacity));
+    T* base = reinterpret_cast<T*>(block.get());
+    uint32_t* material = reinterpret_cast<uint32_t*>(base + kFields * capacity);
+    if (size_ > 0) {
+      for (size_t f = 0; f < kFields; ++f) {
+        std::memcpy(base + f * capacity, cx_ + f * capacity_, size_ * sizeof(T));
+      }
+      std::memcpy(material, material_, size_ * sizeof(uint32_t));
+    }
+
+    block_ = std::move(block);
+    capacity_ = capacity;
+    cx_ = base;
+    cy_ = base + capacity;
+    cz_ = base + 2 * capacity;
+    r_ = base + 3 * capacity;
+    material_ = material;
+  }
+
+  void clear() {
+    block_.reset();
+    materials_ = std::make_shared<MaterialTable>();
+    size_ = capacity_ = 0;
+    cx_ = cy_ = cz_ = r_ = nullptr;
+    material_ = nullptr;
+  }
+
+  size_t size() const { return size_; }
+
+  Vec3<T> center(const SphereHandle h) const { return {cx_[h.index], cy_[h.index], cz_[h.index]}; }
+  T radius(const SphereHandle h) const { return r_[h.index]; }
+  const std::shared_ptr<Material<T>>& material(const SphereHandle h) const {
+    return (*materials_)[material_[h.index]];
+  }
+
+  bool intersect(const Ray<T>& ray, const T t_min, const T t_max, PrimitiveHit<T>& hit) const override {
+    T closest = std::min(t_max, hit.t);
+    size_t closest_index = SIZE_MAX;
+    if constexpr (std::is_same_v<T, float>) {
+      // vectorized over the arrays, at the SIMD level picked at startup
+      closest_index = closest_sphere_hit(arrays(), ray.origin().data(), ray.direction().data(), t_min, t_max, closest);
+    } else {
+      const Vec3<T>& o = ray.origin();
+      const Vec3<T>& d = ray.direction();
+      const T a = dot(d, d);
+
+      for (size_t i = 0; i < size_; ++i) {
+        const T ox = o.x() - cx_[i];
+        const T oy = o.y() - cy_[i];
+        const T oz = o.z() - cz_[i];
+        const T b = T(2) * (ox * d.x() + oy * d.y() + oz * d.z());
+        const T c = ox * ox + oy * oy + oz * oz - r_[i] * r_[i];
+        const T discriminant = b * b - 4 * a * c;
+        if (discriminant < T(0)) continue;
+
+        // find nearest (to ray) root within acceptable range
+        const T sq = std::sqrt(discriminant);
+        T root = (-b - sq) / (T(2) * a);
+        if (root < t_min || root > closest) {
+          root = (-b + sq) / (T(2) * a);
+          if (root < t_min || root > closest) continue;
+        }
+
+        closest = root;
+        closest_index = i;
+      }
+    }
+
+    if (closest_index == SIZE_MAX || !(closest < hit.t)) return false;
+
+    hit.t = closest;
+    hit.primitive = static_cast<uint32_t>(closest_index);
+    hit.object = this;
+    return true;
+  }
+
+  void finalize_hit(const Ray<T>& ray, const PrimitiveHit<T>& hit, HitRecord<T>& record) const override {
+    fill_record({hit.primitive}, ray, hit.t, record);
+  }
+
+  /// Nearest intersection of one sphere with the ray within [t_min, t_max], same arithmetic as hit.
+  bool hit_sphere(const SphereHandle h, const Ray<T>& ray, const T t_min, const T t_max, T& t) const {
+    const Vec3<T>& o = ray.origin();
+    const Vec3<T>& d = ray.direction();
+    const T a = d.x() * d.x() + d.y() * d.y() + d.z() * d.z();
+    const T ox = o.x() - cx_[h.index];
+    const T oy = o.y() - cy_[h.index];
+    const T oz = o.z() - cz_[h.index];
+    const T b = T(2) * (ox * d.x() + oy * d.y() + oz * d.z());
+    const T c = ox * ox + oy * oy + oz * oz - r_[h.index] * r_[h.index];
+    const T discriminant = b * b - 4 * a * c;
+    if (discriminant < T(0)) return false;
+
+    const T sq = std::sqrt(discriminant);
+    T root = (-b - sq) / (T(2) * a);
+    if (root < t_min || root > t_max) {
+      root = (-b + sq) / (T(2) * a);
+      if (root < t_min || root > t_max) return false;
+    }
+    t = root;
+    return true;
+  }
+
+  /// Hit attributes of sphere 'h' at distance 't' along the ray.
+  void fill_record(const SphereHandle h, const Ray<T>& ray, const T t, HitRecord<T>& record) const {
+    const Vec3<T> p = ray.at(t);
+    const Vec3<T> outward_normal = normalize(p - center(h));
+    record.Update(p, outward_normal, t, ray, material(h));
+    // spheres may have no material
+    if (record.material_ptr != nullptr && record.material_ptr->needs_uv()) {
+      record.UpdateSphereUV(outward_normal, r_[h.index], ray);
+    }
+  }
+
+  AABB<T> bounds(const SphereHandle h) const { return AABB<T>::sphere(center(h), r_[h.index]); }
+
+  bool occluded(const Ray<T>& ray, const T t_min, const T t_max) const override {
+    if constexpr (std::is_same_v<T, float>) {
+      return any_sphere_hit(arrays(), ray.origin().data(), ray.direction().data(), t_min, t_max);
+    } else {
+      const Vec3<T>& o = ray.origin();
+      const Vec3<T>& d = ray.direction();
+      const T a = dot(d, d);
+
+      for (size_t i = 0; i < size_; ++i) {
+        const T ox = o.x() - cx_[i];
+        const T oy = o.y() - cy_[i];
+        const T oz = o.z() - cz_[i];
+        const T b = T(2) * (ox * d.x() + oy * d.y() + oz * d.z());
+        const T c = ox * ox + oy * oy + oz * oz - r_[i] * r_[i];
+        const T discriminant = b * b - 4 * a * c;
+        if (discriminant < T(0)) continue;
+
+        const T sq = std::sqrt(discriminant);
+        const T near = (-b - sq) / (T(2) * a);
+        const T far = (-b + sq) / (T(2) * a);
+        if ((near >= t_min && near <= t_max) || (far >= t_min && far <= t_max)) return true;
+      }
+      return false;
+    }
+  }
+
+  uint64_t fingerprint(const BoundsFilter<T>& filter = {}) const override {
+    uint64_t hash = size_;
+    for (size_t i = 0; i < size_; ++i) {
+      const SphereHandle h = {static_cast<uint32_t>(i)};
+      if (filter && !filter(center(h), std::abs(r_[i]))) {
+        hash = hash_combine(hash, 0U);
+        continue;
+      }
+      hash = hash_combine(hash_combine_value(hash_combine_value(hash, center(h)), r_[i]),
+                          material_fingerprint(material(h).get()));
+    }
+    return hash;
+  }
+
+  std::shared_ptr<const Hittable<T>> cull(const BoundsFilter<T>& filter) const override {
+    auto subset = std::make_shared<SceneArena<T>>();
+    subset->materials_ = materials_;
+    for (size_t i = 0; i < size_; ++i) {
+      const SphereHandle h = {static_cast<uint32_t>(i)};
+      if (filter(center(h), std::abs(r_[i]))) subset->add_sphere(center(h), r_[i], {material_[i]});
+    }
+    return subset;
+  }
+
+  std::shared_ptr<Hittable<T>> replicate() const override {
+    auto copy = std::make_shared<SceneArena<T>>();
+    copy->materials_ = std::make_shared<MaterialTable>(*materials_);
+    copy->reserve(size_);
+    for (size_t i = 0; i < size_; ++i) {
+      const SphereHandle h = {static_cast<uint32_t>(i)};
+      copy->add_sphere(center(h), r_[i], {material_[i]});
+    }
+    return copy;
+  }
+
+private:
+  SphereArrays arrays() const { return {cx_, cy_, cz_, r_, size_}; }
+
+  static constexpr size_t kFields = 4;  // cx, cy, cz, r
+  static constexpr size_t kMinCapacity = 16;
+  static constexpr std::align_val_t kAlignment{64};
+
+  struct BlockDeleter {
+    void operator()(std::byte* p) const { ::operator delete[](p, kAlignment); }
+  };
+  using Block = std::unique_ptr<std::byte[], BlockDeleter>;
+
+  static std::byte* allocate(const size_t capacity) {
+    const size_t bytes = kFields * capacity * sizeof(T) + capacity * sizeof(uint32_t);
+    return static_cast<std::byte*>(::operator new[](bytes, kAlignment));
+  }
+
+  Block block_;
+  size_t size_ = 0;
+  size_t capacity_ = 0;
+  T* cx_ = nullptr;
+  T* cy_ = nullptr;
+  T* cz_ = nullptr;
+  T* r_ = nullptr;
+  uint32_t* material_ = nullptr;
+
+  using MaterialTable = std::vector<std::shared_ptr<Material<T>>>;
+  std::shared_ptr<MaterialTable> materials_ = std::make_shared<MaterialTable>();  // shared with cull()'s subsets
+};
+
+}  // namespace rtow
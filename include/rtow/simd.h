@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace rtow {
+
+/// Instruction sets the vectorized kernels are built for. Every level computes bit-identical results
+/// (same operations in the same order, no FMA contraction); only the number of lanes differs.
+enum class SimdLevel { SCALAR = 0, SSE42 = 1, AVX2 = 2, AVX512 = 3 };
+
+const char* to_string(SimdLevel level);
+
+/// Accepts "scalar", "sse4.2", "avx2" and "avx512".
+bool parse_simd_level(const std::string& name, SimdLevel& level);
+
+/// Best level this CPU (and OS) supports.
+SimdLevel detect_simd_level();
+
+/// Level the kernels currently run at. Chosen on first use: the detected level, unless the RTOW_SIMD
+/// environment variable names a lower one.
+SimdLevel simd_level();
+
+/// Forces a level, e.g. for benchmarking; levels the CPU doesn't support fall back to the best one it
+/// does. Returns the level in use.
+SimdLevel set_simd_level(SimdLevel level);
+
+/// Tone-mapping operators, applied per channel to exposed linear radiance.
+enum class ToneMap { CLAMP = 0, REINHARD = 1, ACES = 2 };
+
+/// Display encodings: a pure power curve, or the piecewise sRGB curve.
+enum class TransferFunction { GAMMA = 0, SRGB = 1 };
+
+/// Structure-of-arrays view of 'n' spheres.
+struct SphereArrays {
+  const float* cx = nullptr;
+  const float* cy = nullptr;
+  const float* cz = nullptr;
+  const float* r = nullptr;
+  size_t n = 0;
+};
+
+/// Index of the sphere with the nearest intersection in [t_min, t_max] along the ray, or SIZE_MAX.
+/// Ties go to the higher index. The hit distance is returned in 't'.
+size_t closest_sphere_hit(const SphereArrays& spheres, const float origin[3], const float direction[3], float t_min,
+                          float t_max, float& t);
+
+/// Whether any sphere intersects the ray within [t_min, t_max].
+bool any_sphere_hit(const SphereArrays& spheres, const float origin[3], const float direction[3], float t_min,
+                    float t_max);
+
+/// out[i] = (in[i] * scale) ^ exponent for 'n' floats; non-positive values map to 0. Uses polynomial
+/// log2/exp2 approximations (relative error below 1e-5), far below 8-bit quantization.
+void scale_and_gamma(const float* in, float* out, size_t n, float scale, float exponent);
+
+/// out[i] = int(clamp(in[i], 0, 0.9999) * 255.99) for 'n' floats, the quantization of write_color.
+/// NaNs map to 0.
+void quantize_unorm8(const float* in, uint8_t* out, size_t n);
+
+/// Fused display transform of 'n' floats: scale (averaging and exposure), tone map, clamp to [0, 1],
+/// encode with 'transfer' (GAMMA raises to 'exponent') and quantize like quantize_unorm8.
+void tone_map_unorm8(const float* in, uint8_t* out, size_t n, float scale, ToneMap op, TransferFunction transfer,
+                     float exponent);
+
+}  // namespace rtow
@@ -13,7 +13,7 @@ public:
       , center_(center)
       , radius_(radius) {}
 
-  bool hit(const Ray<T>& ray, const T t_min, const T t_max, HitRecord<T>& record) const override {
+  bool intersect(const Ray<T>& ray, const T t_min, const T t_max, PrimitiveHit<T>& hit) const override {
     const Vec3<T> oc = ray.origin() - center_;
     const auto a = dot(ray.direction(), ray.direction());
     const auto b = T(2) * dot(oc, ray.direction());
@@ -30,15 +30,55 @@ public:
         return false;
       }
     }
+    if (!(root < hit.t)) return false;
 
-    // update hit record
-    const Vec3<T> p = ray.at(root);
+    hit.t = root;
+    hit.primitive = 0;
+    hit.object = this;
+    return true;
+  }
+
+  void finalize_hit(const Ray<T>& ray, const PrimitiveHit<T>& hit, HitRecord<T>& record) const override {
+    const Vec3<T> p = ray.at(hit.t);
     const Vec3<T> outside_normal = normalize(p - center_);
-    record.Update(p, outside_normal, root, ray, this->material_ptr_);
+    record.Update(p, outside_normal, hit.t, ray, this->material_ptr_);
+    // spheres may have no material
+    if (this->material_ptr_ != nullptr && this->material_ptr_->needs_uv()) {
+      record.UpdateSphereUV(outside_normal, radius_, ray);
+    }
+  }
 
+  bool occluded(const Ray<T>& ray, const T t_min, const T t_max) const override {
+    const Vec3<T> oc = ray.origin() - center_;
+    const auto a = dot(ray.direction(), ray.direction());
+    const auto b = T(2) * dot(oc, ray.direction());
+    const auto c = dot(oc, oc) - radius_ * radius_;
+    const auto discriminant = b * b - 4 * a * c;
+    if (discriminant < T(0)) return false;
+
+    const auto d = sqrt(discriminant);
+    const auto near = (-b - d) / (T(2) * a);
+    const auto far = (-b + d) / (T(2) * a);
+    return (near >= t_min && near <= t_max) || (far >= t_min && far <= t_max);
+  }
+
+  uint64_t fingerprint(const BoundsFilter<T>& filter = {}) const override {
+    if (filter && !filter(center_, std::abs(radius_))) return 0U;
+    return hash_combine(hash_combine_value(hash_combine_value(0U, center_), radius_),
+                        material_fingerprint(this->material_ptr_.get()));
+  }
+
+  bool bounding_sphere(Vec3<T>& center, T& radius) const override {
+    center = center_;
+    radius = std::abs(radius_);
     return true;
   }
 
+  std::shared_ptr<Hittable<T>> replicate() const override { return std::make_shared<Sphere<T>>(*this); }
+
+  const Vec3<T>& center() const { return center_; }
+  T radius() const { return radius_; }
+
 private:
   Vec3<T> center_ = {Vec3<T>::NaN};
   T radius_ = Vec3<T>::NaN;
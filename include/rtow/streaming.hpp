@@ -0,0 +1,70 @@
+#pragma once
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include "rtow/bounded_queue.hpp"
+#include "rtow/image.h"
+#include "rtow/postprocess.h"
+#include "rtow/renderer.hpp"
+
+namespace rtow {
+
+struct StreamingStats {
+  size_t bands = 0;
+  size_t peak_band_bytes = 0;  // framebuffer memory held at once: the bands in flight
+  double render_ms = 0.;
+  double write_ms = 0.;        // encoding and output, overlapped with rendering
+};
+
+/// Renders a width x height frame as horizontal bands of 'band_height' rows and streams each finished band
+/// to 'out' as PPM rows, through the display transform 'display', while the next band renders. Only the
+/// band being rendered plus at most 'queue_depth' finished bands are held in memory, instead of the whole
+/// frame.
+template <typename T>
+StreamingStats render_streaming(const Renderer<T>& renderer, const size_t width, const size_t height,
+                                const size_t band_height, const size_t spp, const PostProcessSettings& display,
+                                std::ostream& out, const size_t queue_depth = 2) {
+  using Clock = std::chrono::steady_clock;
+  const auto elapsed_ms = [](const Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  };
+
+  StreamingStats stats;
+  const size_t rows = std::max<size_t>(band_height, 1);
+  // the accumulator and the display band on the render side, plus the queued and the encoding band
+  stats.peak_band_bytes = width * rows * (sizeof(color) + (1 + queue_depth + 1) * 3);
+
+  out << "P3\n" << width << " " << height << "\n255\n";
+
+  BoundedQueue<Image8> queue(queue_depth);
+  std::thread writer([&] {
+    Image8 band;
+    while (queue.pop(band)) {
+      const auto start = Clock::now();
+      to_ppm(band, out, false);
+      stats.write_ms += elapsed_ms(start);
+    }
+  });
+
+  const auto start = Clock::now();
+  for (size_t row = 0; row < height; row += rows) {
+    const size_t band_rows = std::min(rows, height - row);
+    Image accumulator = {width, band_rows, PIXEL_FORMAT::RGB};
+    accumulator.alloc();
+
+    renderer.render_pass(accumulator, spp, row);
+    Image8 band;
+    post_process(accumulator, spp, display, band);
+    queue.push(std::move(band));
+    ++stats.bands;
+  }
+  stats.render_ms = elapsed_ms(start);
+
+  queue.close();
+  writer.join();
+  return stats;
+}
+
+}  // namespace rtow
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "rtow/renderer.hpp"
+
+namespace rtow {
+
+struct TemporalSettings {
+  size_t spp_with_history = 2;      // new samples for pixels whose history survived reprojection
+  size_t spp_without_history = 16;  // new samples for disoccluded or view-dependent pixels
+  float max_history = 64.F;         // cap on reused samples; bounds lag when lighting changes
+  float depth_tolerance = 0.02F;    // relative camera-depth mismatch treated as a disocclusion
+  float position_tolerance = 0.05F; // first-hit distance, relative to depth, treated as a different surface
+};
+
+/// Accumulates radiance across consecutive frames of a moving camera. The previous frame's radiance and
+/// first hits are reprojected into the new view through the pose delta and Camera::project; history is
+/// only reused where the reprojected first hit agrees in depth and position, and only on diffuse
+/// surfaces, whose radiance doesn't depend on the viewpoint.
+template <typename T = float>
+class TemporalAccumulator {
+public:
+  TemporalAccumulator(const size_t width, const size_t height, const TemporalSettings& settings = {})
+      : width_(width)
+      , height_(height)
+      , settings_(settings)
+      , previous_(width, height)
+      , current_(width, height) {}
+
+  void reset() { has_history_ = false; }
+
+  /// Renders the view from 'pose_world_camera' into 'radiance' (linear per-pixel means).
+  /// Returns the fraction of pixels that reused history.
+  float render(Renderer<T>& renderer, const pose<T>& pose_world_camera, Image& radiance) {
+    renderer.set_pose(pose_world_camera);
+    current_.T_world_camera = renderer.transform();
+    const RigidTransform<T> T_camera_world = renderer.transform().inverse();
+
+    // current camera frame -> previous camera frame
+    const RigidTransform<T> T_delta = has_history_ ? previous_.T_world_camera.inverse() * current_.T_world_camera
+                                                   : RigidTransform<T>();
+
+    std::vector<uint8_t> reused(width_ * height_, 0);
+    renderer.for_each_pixel(width_, height_, [&](const size_t u, const size_t v) {
+      const size_t i = v * width_ + u;
+
+      // first hit through the pixel center
+      HitRecord<T> record;
+      const Ray<T> ray = renderer.primary_ray(static_cast<T>(u) + T(0.5), static_cast<T>(v) + T(0.5));
+      // only diffuse surfaces look the same from the next pose; spheres may have no material
+      current_.depth[i] = std::numeric_limits<T>::infinity();
+      if (renderer.world().hit(ray, kRayEpsilon<T>, kRayFar<T>, record) && record.material_ptr != nullptr &&
+          record.material_ptr->is_diffuse()) {
+        current_.position[i] = record.p;
+        current_.depth[i] = T_camera_world.transform_point(record.p).z();
+      }
+
+      color history = {0.F};
+      float history_samples = 0.F;
+      if (has_history_ && std::isfinite(current_.depth[i])) {
+        const Vec3<T> p_camera = T_camera_world.transform_point(record.p);
+        reproject(renderer.camera(), T_delta.transform_point(p_camera), record.p, history, history_samples);
+      }
+
+      const size_t spp = history_samples > 0.F ? settings_.spp_with_history : settings_.spp_without_history;
+      const color sum = renderer.sample_pixel(u, v, spp, frame_ * kSamplesPerFrame);
+      const float samples = history_samples + static_cast<float>(spp);
+
+      current_.radiance.at(u, v) = (history * history_samples + sum) / samples;
+      current_.samples[i] = samples;
+      radiance.at(u, v) = current_.radiance.at(u, v);
+      reused[i] = history_samples > 0.F;
+    });
+
+    std::swap(previous_, current_);
+    has_history_ = true;
+    ++frame_;
+
+    size_t num_reused = 0;
+    for (const uint8_t r : reused) num_reused += r;
+    return static_cast<float>(num_reused) / static_cast<float>(width_ * height_);
+  }
+
+private:
+  struct Frame {
+    Frame(const size_t width, const size_t height)
+        : radiance(width, height, PIXEL_FORMAT::RGB)
+        , samples(width * height, 0.F)
+        , depth(width * height, std::numeric_limits<T>::infinity())
+        , position(width * height) {
+      radiance.alloc();
+    }
+
+    RigidTransform<T> T_world_camera;
+    Image radiance;                 // linear per-pixel means
+    std::vector<float> samples;     // samples behind each mean
+    std::vector<T> depth;           // camera-frame z of the first hit; inf if unusable
+    std::vector<Vec3<T>> position;  // world-frame first hit
+  };
+
+  // Bilinearly gathers the previous frame's radiance around the projection of 'p_previous' (the first
+  // hit in the previous camera frame), keeping only the taps that saw the same surface.
+  void reproject(const Camera<T>& camera, const Vec3<T>& p_previous, const Vec3<T>& p_world, color& history,
+                 float& history_samples) const {
+    const T z = p_previous.z();
+    if (z <= T(0)) return;
+
+    const Vec2<T> uv = camera.project(p_previous);
+    const T x = uv[0] - T(0.5);
+    const T y = uv[1] - T(0.5);
+    const T x0 = std::floor(x);
+    const T y0 = std::floor(y);
+
+    color sum = {0.F};
+    float samples = 0.F;
+    float weight_sum = 0.F;
+    for (int dy = 0; dy < 2; ++dy) {
+      for (int dx = 0; dx < 2; ++dx) {
+        const T px = x0 + T(dx);
+        const T py = y0 + T(dy);
+        if (px < T(0) || py < T(0) || px >= T(width_) || py >= T(height_)) continue;
+
+        const size_t i = static_cast<size_t>(py) * width_ + static_cast<size_t>(px);
+        const T depth = previous_.depth[i];
+        if (!std::isfinite(depth) || std::abs(depth - z) > settings_.depth_tolerance * z) continue;
+        if ((previous_.position[i] - p_world).norm() > settings_.position_tolerance * z) continue;
+
+        const float w = static_cast<float>((dx ? x - x0 : T(1) - (x - x0)) * (dy ? y - y0 : T(1) - (y - y0)));
+        sum += previous_.radiance.data()[i] * w;
+        samples += previous_.samples[i] * w;
+        weight_sum += w;
+      }
+    }
+
+    if (weight_sum < 1e-3F) return;
+    history = sum / weight_sum;
+    history_samples = std::min(samples / weight_sum, settings_.max_history);
+  }
+
+  // frames draw disjoint sample indices so their noise is uncorrelated
+  static constexpr size_t kSamplesPerFrame = 1U << 16U;
+
+  size_t width_ = 0;
+  size_t height_ = 0;
+  size_t frame_ = 0;
+  TemporalSettings settings_;
+  Frame previous_;
+  Frame current_;
+  bool has_history_ = false;
+};
+
+}  // namespace rtow
@@ -0,0 +1,90 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rtow/color.h"
+
+namespace rtow {
+
+/// Color as a function of surface parameters, for materials whose albedo varies over the surface.
+class Texture {
+public:
+  virtual ~Texture() = default;
+
+  /// Linear RGB at (u, v), averaged over a footprint 'width' wide in uv units (0: the finest detail).
+  virtual color value(float u, float v, float width) const = 0;
+
+  /// Hash of the texture's contents; equal fingerprints give equal values.
+  virtual uint64_t fingerprint() const = 0;
+};
+
+struct TextureCacheStats {
+  size_t hits = 0;
+  size_t misses = 0;
+
+  double hit_rate() const { return hits + misses > 0 ? static_cast<double>(hits) / static_cast<double>(hits + misses) : 0.; }
+};
+
+/// Tile lookups of every thread's texture cache (see MipTexture) since the last reset.
+TextureCacheStats texture_cache_stats();
+void reset_texture_cache_stats();
+
+/// Mip-mapped image texture of 8-bit sRGB pixels, repeating in both directions. Every level is stored in
+/// kTileSize x kTileSize tiles, so a filtered lookup touches one or a few small blocks instead of rows
+/// that are a whole texture width apart. Lookups go through a small per-thread cache of tiles already
+/// decoded to linear color, and blend the two levels whose texel size brackets the footprint (trilinear).
+///
+/// The tiled layout is also the file format: save() writes it and open() maps a file read-only, so tiles
+/// of a large texture are only read from disk when a lookup first needs them.
+class MipTexture : public Texture {
+public:
+  static constexpr size_t kTileSize = 16;
+
+  /// Builds the mip chain of 'width' x 'height' interleaved sRGB pixels, averaging in linear color. An
+  /// empty image gives a black texture.
+  MipTexture(const uint8_t* rgb, size_t width, size_t height);
+  ~MipTexture() override;
+
+  MipTexture(const MipTexture&) = delete;
+  MipTexture& operator=(const MipTexture&) = delete;
+
+  /// Maps a file written by save(). Returns null if it can't be read or isn't a valid texture file.
+  static std::shared_ptr<MipTexture> open(const std::string& path);
+
+  bool save(const std::string& path) const;
+
+  color value(float u, float v, float width) const override;
+  uint64_t fingerprint() const override;
+
+  size_t width() const;
+  size_t height() const;
+  size_t levels() const;
+
+  /// Texel (x, y) of 'level', unfiltered and uncached.
+  color texel(size_t level, size_t x, size_t y) const;
+
+private:
+  struct Level {
+    size_t width = 0;
+    size_t height = 0;
+    size_t tiles_u = 0;
+    size_t offset = 0;  // of the first tile, from the start of the file image
+  };
+
+  MipTexture() = default;
+  bool attach(const uint8_t* bytes, size_t size);
+
+  color bilinear(size_t level, float u, float v) const;
+  const color* decoded_tile(size_t level, size_t tx, size_t ty) const;
+
+  uint64_t id_ = 0;  // unique per texture object, so cached tiles of different textures never collide
+  std::vector<uint8_t> storage_;  // the file image when built in memory
+  const uint8_t* bytes_ = nullptr;
+  size_t size_ = 0;
+  bool mapped_ = false;
+  std::vector<Level> levels_;
+};
+
+}  // namespace rtow
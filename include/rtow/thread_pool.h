@@ -0,0 +1,61 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "rtow/numa.h"
+
+namespace rtow {
+
+/// Fixed set of worker threads running data-parallel loops. Several threads may submit loops at the
+/// same time; they are served in submission order and the submitting thread helps with its own loop.
+///
+/// Given a NUMA topology, the threads are spread over the nodes and each worker is pinned to its node's
+/// CPUs. Loops then hand every node a contiguous share of the indices, and a thread only takes indices
+/// of another node once its own node's share is used up. The submitting thread counts as node 0. A
+/// single-node topology gives the same pool as the plain constructor.
+class ThreadPool {
+public:
+  explicit ThreadPool(size_t num_threads = std::thread::hardware_concurrency());
+  ThreadPool(size_t num_threads, const NumaTopology& topology);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /// Number of threads working on a loop, including the submitting thread.
+  size_t size() const { return workers_.size() + 1; }
+
+  /// 1 unless the pool was built for a NUMA topology.
+  size_t num_nodes() const { return node_cpus_.size(); }
+
+  /// Node of the calling thread: its node if it is a worker of a NUMA pool, otherwise 0.
+  static size_t current_node();
+
+  /// Runs fn() on a temporary thread pinned to 'node' and waits for it, so memory fn first touches is
+  /// placed on that node. Runs fn() on the calling thread if pinning is not possible.
+  void run_on_node(size_t node, const std::function<void()>& fn) const;
+
+  /// Runs fn(i) for every i in [0, n) and blocks until all of them have returned.
+  void parallel_for(size_t n, const std::function<void(size_t)>& fn);
+
+private:
+  struct Job;
+
+  void worker_loop(size_t node);
+  void run(Job& job);
+  void retire(const std::shared_ptr<Job>& job);
+
+  std::vector<std::vector<size_t>> node_cpus_;  // empty CPU list: don't pin
+  std::vector<std::thread> workers_;
+  std::deque<std::shared_ptr<Job>> jobs_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool stop_ = false;
+};
+
+}  // namespace rtow
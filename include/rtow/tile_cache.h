@@ -0,0 +1,51 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "rtow/image.h"
+
+namespace rtow {
+
+struct TileCacheStats {
+  size_t hits = 0;
+  size_t misses = 0;
+  size_t bytes_saved = 0;    // tile data loaded instead of rendered
+  size_t bytes_written = 0;
+
+  double hit_rate() const { return hits + misses > 0 ? static_cast<double>(hits) / static_cast<double>(hits + misses) : 0.; }
+};
+
+/// Content-addressed store of rendered tiles in a local directory, one file per key. Keys must cover
+/// everything the tile's pixels depend on (see tile_key); a stored tile is never invalidated, it just
+/// stops being looked up. Safe to use from several threads and processes at once.
+class TileCache {
+public:
+  explicit TileCache(const std::string& directory);
+
+  TileCache(const TileCache&) = delete;
+  TileCache& operator=(const TileCache&) = delete;
+
+  /// Fills 'tile' (allocated, with the tile's size) from the cache. Returns false on a miss, including
+  /// entries with a different size or a truncated file.
+  bool load(uint64_t key, Image& tile);
+
+  /// Stores 'tile' under 'key'. The entry appears atomically, so readers never see partial tiles.
+  bool store(uint64_t key, const Image& tile);
+
+  const std::string& directory() const { return directory_; }
+
+  TileCacheStats stats() const;
+  void reset_stats();
+
+private:
+  std::string path(uint64_t key) const;
+
+  std::string directory_;
+  std::atomic<size_t> hits_ = 0;
+  std::atomic<size_t> misses_ = 0;
+  std::atomic<size_t> bytes_saved_ = 0;
+  std::atomic<size_t> bytes_written_ = 0;
+};
+
+}  // namespace rtow
@@ -1,13 +1,89 @@
 #pragma once
 
-#include <random>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
 
 namespace rtow {
+
+/// splitmix64 finalizer; spreads every input bit over the whole output.
+inline uint64_t mix64(uint64_t x) {
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+/// Folds 'value' into the running hash 'seed'.
+inline uint64_t hash_combine(const uint64_t seed, const uint64_t value) {
+  return mix64(seed ^ (value + 0x9E3779B97F4A7C15ULL + (seed << 6U) + (seed >> 2U)));
+}
+
+/// Folds the bytes of a trivially copyable value (scalars, Vec, Matrix) into the running hash 'seed'.
+template <typename V>
+inline uint64_t hash_combine_value(uint64_t seed, const V& value) {
+  static_assert(std::is_trivially_copyable_v<V>);
+  unsigned char bytes[sizeof(V)];
+  std::memcpy(bytes, &value, sizeof(V));
+  for (size_t i = 0; i < sizeof(V); i += sizeof(uint64_t)) {
+    uint64_t word = 0;
+    std::memcpy(&word, bytes + i, std::min(sizeof(uint64_t), sizeof(V) - i));
+    seed = hash_combine(seed, word);
+  }
+  return seed;
+}
+
+/// PCG32 (XSH-RR) generator, see https://www.pcg-random.org. Its state is two words, so it can be
+/// reseeded for every pixel sample.
+class Pcg32 {
+public:
+  explicit Pcg32(const uint64_t seed = 42U, const uint64_t stream = 0U) { this->seed(seed, stream); }
+
+  void seed(const uint64_t seed, const uint64_t stream = 0U) {
+    state_ = 0U;
+    inc_ = (stream << 1U) | 1U;
+    next();
+    state_ += seed;
+    next();
+  }
+
+  uint32_t next() {
+    const uint64_t old = state_;
+    state_ = old * 6364136223846793005ULL + inc_;
+    const uint32_t xorshifted = static_cast<uint32_t>(((old >> 18U) ^ old) >> 27U);
+    const uint32_t rot = static_cast<uint32_t>(old >> 59U);
+    return (xorshifted >> rot) | (xorshifted << ((32U - rot) & 31U));
+  }
+
+private:
+  uint64_t state_ = 0U;
+  uint64_t inc_ = 1U;
+};
+
+/// The calling thread's generator. Threads start on distinct streams.
+inline Pcg32& thread_generator() {
+  static std::atomic<uint64_t> streams{0};
+  static thread_local Pcg32 generator(42U, streams++);
+  return generator;
+}
+
+/// Restarts the calling thread's sequence. The renderer reseeds for every pixel sample from the pixel and
+/// sample index, so results don't depend on which thread renders a sample or in which order.
+inline void seed_random(const uint64_t seed) { thread_generator().seed(seed); }
+
+/// Uniform number in [min, max) from the calling thread's generator.
 template <typename T>
-inline T random(const T min = T(0), const T max = T(1), T seed = T(42)) {
-  static std::uniform_real_distribution<T> distribution(min, max);
-  static std::mt19937 generator(seed);
-  return distribution(generator);
+inline T random(const T min = T(0), const T max = T(1)) {
+  Pcg32& generator = thread_generator();
+  T unit;
+  if constexpr (std::is_same_v<T, float>) {
+    unit = static_cast<float>(generator.next() >> 8U) * 0x1.0p-24F;
+  } else {
+    const uint64_t bits = (static_cast<uint64_t>(generator.next()) << 21U) ^ (generator.next() >> 11U);
+    unit = static_cast<T>(bits & ((1ULL << 53U) - 1U)) * T(0x1.0p-53);
+  }
+  return min + (max - min) * unit;
 }
 
-}  // namespace rtow
\ No newline at end of file
+}  // namespace rtow
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <type_traits>
+
 #include "rtow/utils.hpp"
 #include "rtow/vec.hpp"
 namespace rtow {
@@ -19,7 +21,7 @@ inline std::ostream& operator<<(std::ostream& out, const Vec2<T>& v) {
 
 template <typename T, size_t N, typename Fn>
 inline Vec<T, N> compose(const Vec<T, N>& v1, const Vec<T, N>& v2,
-                         Fn fn) requires Derived<std::binary_function<T, T, T>, Fn> {
+                         Fn fn) requires std::is_invocable_r_v<T, Fn, T, T> {
   Vec<T, N> v;
   for (size_t i = 0; i < N; ++i) {
     v[i] = fn(v1[i], v2[i]);
@@ -84,6 +86,32 @@ inline Vec<T, N> normalize(const Vec<T, N>& v) {
   return v / v.norm();
 }
 
+/// Completes a unit vector n to a right-handed orthonormal basis (b1, b2, n).
+/// see: Duff et al., "Building an Orthonormal Basis, Revisited", JCGT 2017
+template <typename T>
+inline void orthonormal_basis(const Vec3<T>& n, Vec3<T>& b1, Vec3<T>& b2) {
+  const T sign = std::copysign(T(1), n.z());
+  const T a = T(-1) / (sign + n.z());
+  const T b = n.x() * n.y() * a;
+  b1 = {T(1) + sign * n.x() * n.x() * a, sign * b, -sign * n.x()};
+  b2 = {b, sign + n.y() * n.y() * a, -n.y()};
+}
+
+/// Cosine-weighted direction on the hemisphere around the unit vector n (pdf = cos(theta)/pi).
+/// Maps two uniform numbers through the unit disk (Malley's method); no rejection loop.
+template <typename T>
+inline Vec3<T> random_cosine_direction(const Vec3<T>& n) {
+  const T r = std::sqrt(random(T(0), T(1)));
+  const T phi = T(2) * T(M_PI) * random(T(0), T(1));
+  const T x = r * std::cos(phi);
+  const T y = r * std::sin(phi);
+  const T z = std::sqrt(std::max(T(0), T(1) - x * x - y * y));
+
+  Vec3<T> b1, b2;
+  orthonormal_basis(n, b1, b2);
+  return b1 * x + b2 * y + n * z;
+}
+
 template <typename T>
 inline Vec<T, 3> random_in_unit_sphere() {
   while (true) {
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include "rtow/integrator.hpp"
+#include "rtow/ray_sort.hpp"
+#include "rtow/renderer.hpp"
+
+namespace rtow {
+
+/// Rays traced and time spent per bounce (0 = camera rays) by a wavefront pass.
+struct WavefrontStats {
+  std::vector<uint64_t> rays;
+  std::vector<int64_t> nanoseconds;  // sorting, intersection and shading
+  int64_t sort_nanoseconds = 0;
+
+  void add(const size_t bounce, const uint64_t num_rays, const int64_t ns) {
+    if (rays.size() <= bounce) {
+      rays.resize(bounce + 1, 0);
+      nanoseconds.resize(bounce + 1, 0);
+    }
+    rays[bounce] += num_rays;
+    nanoseconds[bounce] += ns;
+  }
+
+  void merge(const WavefrontStats& other) {
+    for (size_t b = 0; b < other.rays.size(); ++b) {
+      add(b, other.rays[b], other.nanoseconds[b]);
+    }
+    sort_nanoseconds += other.sort_nanoseconds;
+  }
+
+  /// Throughput over all bounces >= 'from_bounce'.
+  double rays_per_second(const size_t from_bounce) const {
+    uint64_t num_rays = 0;
+    int64_t ns = 0;
+    for (size_t b = from_bounce; b < rays.size(); ++b) {
+      num_rays += rays[b];
+      ns += nanoseconds[b];
+    }
+    return ns > 0 ? static_cast<double>(num_rays) / (static_cast<double>(ns) * 1e-9) : 0.;
+  }
+};
+
+/// Adds 'spp' path-traced samples to every pixel of 'accumulator', like Renderer::render_pass, but
+/// breadth-first: each 'batch' x 'batch' block of pixels advances all of its paths one bounce at a time.
+/// With 'sort_rays', the secondary rays of every bounce are reordered by direction octant and origin
+/// (RaySorter) before they are traced; results land in the paths and are scattered back to their
+/// pixels at the end. Results are deterministic, but differ from render_pass, which gives each sample one
+/// random sequence for all of its bounces.
+template <typename T>
+WavefrontStats render_pass_wavefront(const Renderer<T>& renderer, Image& accumulator, const size_t spp,
+                                     const bool sort_rays, const size_t batch = 64) {
+  using Clock = std::chrono::steady_clock;
+
+  WavefrontStats stats;
+  std::mutex stats_mutex;
+
+  const Hittable<T>& world = renderer.world();
+  const LightList<T>& lights = renderer.lights();
+  const size_t max_bounces = renderer.settings().max_ray_bounces;
+
+  renderer.for_each_tile(accumulator.width(), accumulator.height(), batch,
+                         [&](const size_t u0, const size_t v0, const size_t u1, const size_t v1) {
+    WavefrontStats batch_stats;
+    std::vector<PathState<T>> paths;
+    std::vector<color*> pixels;
+    std::vector<uint64_t> seeds;
+    paths.reserve((u1 - u0) * (v1 - v0) * spp);
+    pixels.reserve(paths.capacity());
+    seeds.reserve(paths.capacity());
+
+    for (size_t v = v0; v < v1; ++v) {
+      for (size_t u = u0; u < u1; ++u) {
+        for (size_t k = 0; k < spp; ++k) {
+          seeds.push_back(renderer.sample_seed(u, v, k));
+          seed_random(seeds.back());
+          const T eu = static_cast<T>(u) + random(T(0), T(1));
+          const T ev = static_cast<T>(v) + random(T(0), T(1));
+          paths.emplace_back();
+          paths.back().ray = renderer.primary_ray(eu, ev);
+          pixels.push_back(&accumulator.at(u, v));
+        }
+      }
+    }
+
+    std::vector<uint32_t> active(paths.size());
+    for (uint32_t i = 0; i < active.size(); ++i) active[i] = i;
+    std::vector<uint32_t> still_active;
+    RaySorter<T> sorter;
+    HitRecord<T> record;
+
+    for (size_t bounce = 0; bounce < max_bounces && !active.empty(); ++bounce) {
+      const auto start = Clock::now();
+      const std::vector<uint32_t>* order = &active;
+      if (sort_rays && bounce > 0) {
+        order = &sorter.sort(active, [&paths](const uint32_t i) -> const Ray<T>& { return paths[i].ray; });
+        batch_stats.sort_nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+      }
+
+      still_active.clear();
+      for (const uint32_t i : *order) {
+        PathState<T>& path = paths[i];
+        // paths are interleaved (and maybe reordered), so every bounce gets its own sequence
+        seed_random(mix64(seeds[i] + bounce + 1));
+        const bool hit = world.hit(path.ray, kRayEpsilon<T>, kRayFar<T>, record);
+        shade_path(path, hit ? &record : nullptr, world, lights);
+        if (path.active) still_active.push_back(i);
+      }
+
+      const auto end = Clock::now();
+      batch_stats.add(bounce, order->size(), std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+      std::swap(active, still_active);
+    }
+
+    // scatter back to the pixels
+    for (size_t i = 0; i < paths.size(); ++i) {
+      if (!paths[i].radiance.has_NaN()) *pixels[i] += paths[i].radiance;
+    }
+
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    stats.merge(batch_stats);
+  });
+
+  return stats;
+}
+
+}  // namespace rtow
@@ -0,0 +1,57 @@
+#include "rtow/alias_table.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace rtow {
+
+AliasTable::AliasTable(const std::vector<double>& weights) {
+  double sum = 0.;
+  for (const double w : weights) {
+    if (std::isfinite(w) && w > 0.) sum += w;
+  }
+  if (!(sum > 0.) || !std::isfinite(sum)) return;
+
+  const size_t n = weights.size();
+  probability_.resize(n);
+  threshold_.resize(n);
+  alias_.resize(n);
+
+  // columns scaled so that the average is 1; small ones are topped up from large ones
+  std::vector<uint32_t> small;
+  std::vector<uint32_t> large;
+  for (size_t i = 0; i < n; ++i) {
+    const double w = std::isfinite(weights[i]) && weights[i] > 0. ? weights[i] : 0.;
+    probability_[i] = w / sum;
+    threshold_[i] = probability_[i] * static_cast<double>(n);
+    alias_[i] = static_cast<uint32_t>(i);
+    (threshold_[i] < 1. ? small : large).push_back(static_cast<uint32_t>(i));
+  }
+
+  while (!small.empty() && !large.empty()) {
+    const uint32_t s = small.back();
+    small.pop_back();
+    const uint32_t l = large.back();
+    alias_[s] = l;
+    threshold_[l] -= 1. - threshold_[s];
+    if (threshold_[l] < 1.) {
+      large.pop_back();
+      small.push_back(l);
+    }
+  }
+  // whatever is left is 1 up to rounding
+  for (const uint32_t i : small) {
+    threshold_[i] = 1.;
+  }
+  for (const uint32_t i : large) {
+    threshold_[i] = 1.;
+  }
+}
+
+size_t AliasTable::sample(const double u1, const double u2) const {
+  const size_t n = probability_.size();
+  const size_t column = std::min(n - 1, static_cast<size_t>(u1 * static_cast<double>(n)));
+  return u2 < threshold_[column] ? column : alias_[column];
+}
+
+}  // namespace rtow
@@ -1,5 +1,7 @@
 #include "rtow/color.h"
 
+#include <algorithm>
+
 namespace rtow {
 
 void write_color(std::ostream& out, const color& col) {
@@ -11,4 +13,6 @@ void write_color(std::ostream& out, const color& col) {
   // clang-format on
 }
 
+float luminance(const color& c) { return 0.2126F * c[0] + 0.7152F * c[1] + 0.0722F * c[2]; }
+
 }  // namespace rtow
\ No newline at end of file
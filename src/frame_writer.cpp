@@ -0,0 +1,40 @@
+#include "rtow/frame_writer.h"
+
+#include <chrono>
+#include <fstream>
+
+namespace rtow {
+
+FrameWriter::FrameWriter(size_t queue_depth, std::ostream& log)
+    : queue_(queue_depth)
+    , log_(log)
+    , thread_([this] { loop(); }) {}
+
+FrameWriter::~FrameWriter() { finish(); }
+
+void FrameWriter::write(const std::string& file_path, Image8&& image) {
+  queue_.push({file_path, std::move(image)});
+}
+
+void FrameWriter::finish() {
+  queue_.close();
+  if (thread_.joinable()) thread_.join();
+}
+
+void FrameWriter::loop() {
+  Frame frame;
+  while (queue_.pop(frame)) {
+    const auto start = std::chrono::steady_clock::now();
+    {
+      std::ofstream out(frame.file_path, std::ios_base::out | std::ios_base::trunc);
+      to_ppm(frame.image, out);
+      if (!out) log_ << "Failed to write " << frame.file_path << "\n";
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    busy_us_ += std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    ++frames_written_;
+  }
+}
+
+}  // namespace rtow
@@ -1,22 +1,108 @@
 #include "rtow/image.h"
 
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include "rtow/simd.h"
+
+static_assert(sizeof(rtow::color) == 3 * sizeof(float), "pixels are processed as flat float arrays");
+
 namespace rtow {
+void to_ppm(const uint8_t* rgb, const size_t width, const size_t height, std::ostream& out, bool write_header) {
+  if (write_header) out << "P3\n" << width << " " << height << "\n255\n";
+
+  // format a row at a time by hand
+  std::string text;
+  text.reserve(width * 12);
+  for (size_t i = 0; i < height; ++i) {
+    const uint8_t* row = rgb + i * width * 3;
+    text.clear();
+    for (size_t j = 0; j < width * 3; ++j) {
+      const uint8_t q = row[j];
+      if (q >= 100) text.push_back(static_cast<char>('0' + q / 100));
+      if (q >= 10) text.push_back(static_cast<char>('0' + q / 10 % 10));
+      text.push_back(static_cast<char>('0' + q % 10));
+      text.push_back(j % 3 == 2 ? '\n' : ' ');
+    }
+    out.write(text.data(), static_cast<std::streamsize>(text.size()));
+  }
+}
+
 void to_ppm(const Image& image, std::ostream& out, std::ostream& log, bool write_header) {
   if (write_header) out << "P3\n" << image.width() << " " << image.height() << "\n255\n";
 
   const size_t width = image.width();
-  const size_t height = image.height();
 
-  for (size_t i = 0; i < height; ++i) {
-    for (size_t j = 0; j < width; ++j) {
-      //   log << "Processing: " << i * width + j << "/" << width * height << "("
-      //       << (i * width + j) / double(width * height) * 100. << "%)\n";
-      const color& col = image.data()[i * width + j];
-      //   log << "color at " << i << ", " << j << ": " << col.Print() << "\n";
-      // Divide the color by the number of samples and gamma-correct for gamma=2.0.
-
-      write_color(out, col);
+  // quantize a row at a time (same rounding as write_color)
+  std::vector<uint8_t> quantized(width * 3);
+  for (size_t i = 0; i < image.height(); ++i) {
+    quantize_unorm8(reinterpret_cast<const float*>(image.data() + i * width), quantized.data(), width * 3);
+    to_ppm(quantized.data(), width, 1, out, false);
+  }
+}
+
+void resolve(const Image& accumulator, size_t samples_per_pixel, Image& out) {
+  const size_t n = accumulator.width() * accumulator.height();
+  const float scale = samples_per_pixel > 0 ? 1.F / static_cast<float>(samples_per_pixel) : 0.F;
+
+  // average and gamma-correct
+  scale_and_gamma(reinterpret_cast<const float*>(accumulator.data()), reinterpret_cast<float*>(out.data()), n * 3,
+                  scale, 0.4F);
+}
+
+bool read_pfm(const std::string& path, Image& out) {
+  std::ifstream in(path, std::ios::binary);
+  std::string magic;
+  size_t width = 0;
+  size_t height = 0;
+  float scale = 0.F;
+  if (!(in >> magic >> width >> height >> scale) || (magic != "PF" && magic != "Pf") || width == 0 || height == 0 ||
+      scale == 0.F) {
+    return false;
+  }
+  in.get();  // the single whitespace character ending the header
+
+  const size_t channels = magic == "PF" ? 3 : 1;
+  std::vector<float> values(width * height * channels);
+  if (!in.read(reinterpret_cast<char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(float)))) {
+    return false;
+  }
+  // a negative scale marks little-endian data
+  if ((scale < 0.F) != (std::endian::native == std::endian::little)) {
+    for (float& value : values) {
+      uint32_t bits = 0;
+      std::memcpy(&bits, &value, sizeof(bits));
+      bits = __builtin_bswap32(bits);
+      std::memcpy(&value, &bits, sizeof(bits));
     }
   }
+
+  out = Image(width, height, PIXEL_FORMAT::RGB);
+  out.alloc();
+  // rows are stored bottom to top
+  for (size_t v = 0; v < height; ++v) {
+    const float* row = values.data() + (height - 1 - v) * width * channels;
+    for (size_t u = 0; u < width; ++u) {
+      const float* p = row + u * channels;
+      out.at(u, v) = channels == 3 ? color{p[0], p[1], p[2]} : color{p[0], p[0], p[0]};
+    }
+  }
+  return true;
+}
+
+bool write_pfm(const std::string& path, const Image& image) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  const bool little = std::endian::native == std::endian::little;
+  out << "PF\n" << image.width() << " " << image.height() << "\n" << (little ? "-1.0" : "1.0") << "\n";
+  for (size_t v = image.height(); v-- > 0;) {
+    out.write(reinterpret_cast<const char*>(image.data() + v * image.width()),
+              static_cast<std::streamsize>(image.width() * sizeof(color)));
+  }
+  return static_cast<bool>(out);
 }
-}  // namespace rtow
\ No newline at end of file
+
+}  // namespace rtow
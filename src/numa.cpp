@@ -0,0 +1,94 @@
+#include "rtow/numa.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace rtow {
+
+NumaTopology NumaTopology::detect(const std::string& sysfs_root) {
+  // node directories are numbered but may have gaps (offline or memory-only nodes)
+  std::vector<std::pair<size_t, std::vector<size_t>>> nodes;
+  std::error_code error;
+  for (const auto& entry : std::filesystem::directory_iterator(sysfs_root, error)) {
+    const std::string name = entry.path().filename().string();
+    if (name.size() <= 4 || name.compare(0, 4, "node") != 0 ||
+        !std::all_of(name.begin() + 4, name.end(), [](const char c) { return c >= '0' && c <= '9'; })) {
+      continue;
+    }
+
+    std::ifstream file(entry.path() / "cpulist");
+    std::string list;
+    if (!std::getline(file, list)) continue;
+    std::vector<size_t> cpus = parse_cpu_list(list);
+    if (!cpus.empty()) nodes.emplace_back(std::stoul(name.substr(4)), std::move(cpus));
+  }
+  if (nodes.empty()) return single_node();
+
+  std::sort(nodes.begin(), nodes.end());
+  NumaTopology topology;
+  for (auto& node : nodes) {
+    topology.node_cpus.push_back(std::move(node.second));
+  }
+  return topology;
+}
+
+NumaTopology NumaTopology::single_node() {
+  NumaTopology topology;
+  topology.node_cpus.emplace_back(std::max<size_t>(std::thread::hardware_concurrency(), 1));
+  for (size_t i = 0; i < topology.node_cpus[0].size(); ++i) {
+    topology.node_cpus[0][i] = i;
+  }
+  return topology;
+}
+
+std::vector<size_t> parse_cpu_list(const std::string& list) {
+  std::vector<size_t> cpus;
+  size_t pos = 0;
+  const auto number = [&](size_t& value) {
+    const size_t start = pos;
+    value = 0;
+    for (; pos < list.size() && list[pos] >= '0' && list[pos] <= '9'; ++pos) {
+      value = value * 10 + static_cast<size_t>(list[pos] - '0');
+    }
+    return pos > start;
+  };
+
+  while (pos < list.size() && list[pos] != '\n') {
+    size_t first = 0;
+    size_t last = 0;
+    if (!number(first)) return {};
+    last = first;
+    if (pos < list.size() && list[pos] == '-') {
+      ++pos;
+      if (!number(last) || last < first) return {};
+    }
+    for (size_t cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+    if (pos < list.size() && list[pos] == ',') ++pos;
+  }
+  return cpus;
+}
+
+bool pin_current_thread(const std::vector<size_t>& cpus) {
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (const size_t cpu : cpus) {
+    if (cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+  }
+  return CPU_COUNT(&set) > 0 && pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+  (void)cpus;
+  return false;
+#endif
+}
+
+}  // namespace rtow
@@ -0,0 +1,80 @@
+#include "rtow/postprocess.h"
+
+#include <cmath>
+#include <fstream>
+#include <limits>
+
+namespace rtow {
+
+bool parse_tone_map(const std::string& name, ToneMap& tone_map) {
+  if (name == "clamp") {
+    tone_map = ToneMap::CLAMP;
+  } else if (name == "reinhard") {
+    tone_map = ToneMap::REINHARD;
+  } else if (name == "aces") {
+    tone_map = ToneMap::ACES;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void post_process(const Image& accumulator, size_t samples_per_pixel, const PostProcessSettings& settings, Image8& out) {
+  const size_t width = accumulator.width();
+  const size_t height = accumulator.height();
+  out.width = width;
+  out.height = height;
+  out.rgb.resize(width * height * 3);
+
+  // exposure folds into the averaging scale; the defaults keep the exact scale resolve uses
+  float scale = samples_per_pixel > 0 ? 1.F / static_cast<float>(samples_per_pixel) : 0.F;
+  if (settings.exposure != 0.F) scale *= std::exp2(settings.exposure);
+  const float exponent = settings.gamma > 0.F ? 1.F / settings.gamma : 1.F;
+
+  for (size_t i = 0; i < height; ++i) {
+    tone_map_unorm8(reinterpret_cast<const float*>(accumulator.data() + i * width), out.rgb.data() + i * width * 3,
+                    width * 3, scale, settings.tone_map, settings.transfer, exponent);
+  }
+}
+
+void to_ppm(const Image8& image, std::ostream& out, bool write_header) {
+  to_ppm(image.rgb.data(), image.width, image.height, out, write_header);
+}
+
+bool read_ppm(const std::string& path, Image8& out) {
+  std::ifstream in(path, std::ios::binary);
+  std::string magic;
+  size_t width = 0;
+  size_t height = 0;
+  size_t maxval = 0;
+  // '#' comments may only appear in the header
+  const auto field = [&](size_t& value) {
+    in >> std::ws;
+    while (in.peek() == '#') {
+      in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+      in >> std::ws;
+    }
+    return static_cast<bool>(in >> value);
+  };
+  if (!(in >> magic) || (magic != "P3" && magic != "P6") || !field(width) || !field(height) || !field(maxval) ||
+      maxval != 255 || width == 0 || height == 0) {
+    return false;
+  }
+
+  out.width = width;
+  out.height = height;
+  out.rgb.resize(width * height * 3);
+  if (magic == "P6") {
+    in.get();  // the single whitespace character ending the header
+    in.read(reinterpret_cast<char*>(out.rgb.data()), static_cast<std::streamsize>(out.rgb.size()));
+    return static_cast<bool>(in);
+  }
+  for (uint8_t& value : out.rgb) {
+    size_t v = 0;
+    if (!(in >> v) || v > 255) return false;
+    value = static_cast<uint8_t>(v);
+  }
+  return true;
+}
+
+}  // namespace rtow
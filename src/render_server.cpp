@@ -0,0 +1,354 @@
+#include "rtow/render_server.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <thread>
+
+#include "rtow/camera.hpp"
+#include "rtow/image.h"
+#include "rtow/renderer.hpp"
+
+namespace rtow {
+
+namespace {
+
+// sanity limits on what a single request may ask for
+constexpr size_t kMaxImageSide = 8192;
+constexpr size_t kMaxSamplesPerPixel = 1U << 16U;
+constexpr size_t kMaxBounces = 64;
+// rays per request, width x height x spp x bounces; the limits on each key alone would allow 2^48
+constexpr uint64_t kMaxRaysPerRequest = uint64_t{1} << 32U;
+constexpr size_t kMaxLine = 4096;
+constexpr float kMaxExposureStops = 32.F;
+
+bool parse_floats(const std::string& text, float* values, const size_t n) {
+  std::stringstream ss(text);
+  std::string item;
+  size_t i = 0;
+  while (std::getline(ss, item, ',')) {
+    if (i == n) return false;
+    size_t used = 0;
+    values[i++] = std::stof(item, &used);
+    if (used != item.size()) return false;
+  }
+  return i == n;
+}
+
+bool parse_size(const std::string& text, size_t& value, const size_t max) {
+  size_t used = 0;
+  const unsigned long long parsed = std::stoull(text, &used);
+  if (used != text.size() || parsed == 0 || parsed > max) return false;
+  value = static_cast<size_t>(parsed);
+  return true;
+}
+
+bool write_all(const int fd, const char* data, size_t size) {
+  while (size > 0) {
+    const ssize_t written = ::send(fd, data, size, MSG_NOSIGNAL);
+    if (written < 0 && errno == EINTR) continue;
+    if (written <= 0) return false;
+    data += written;
+    size -= static_cast<size_t>(written);
+  }
+  return true;
+}
+
+// Reads up to and excluding the next '\n'; 'buffer' keeps whatever was received past it.
+bool read_line(const int fd, std::string& buffer, std::string& line) {
+  size_t end = buffer.find('\n');
+  while (end == std::string::npos) {
+    if (buffer.size() > kMaxLine) return false;
+    char chunk[512];
+    const ssize_t received = ::recv(fd, chunk, sizeof(chunk), 0);
+    if (received < 0 && errno == EINTR) continue;
+    if (received <= 0) return false;
+    buffer.append(chunk, static_cast<size_t>(received));
+    end = buffer.find('\n');
+  }
+  line = buffer.substr(0, end);
+  buffer.erase(0, end + 1);
+  return true;
+}
+
+bool read_exactly(const int fd, std::string& buffer, const size_t size, std::string& out) {
+  while (buffer.size() < size) {
+    char chunk[1 << 16];
+    const ssize_t received = ::recv(fd, chunk, sizeof(chunk), 0);
+    if (received < 0 && errno == EINTR) continue;
+    if (received <= 0) return false;
+    buffer.append(chunk, static_cast<size_t>(received));
+  }
+  out = buffer.substr(0, size);
+  buffer.erase(0, size);
+  return true;
+}
+
+bool make_address(const std::string& socket_path, sockaddr_un& address) {
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(address.sun_path)) return false;
+  std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+  return true;
+}
+
+}  // namespace
+
+bool parse_render_request(const std::string& text, RenderRequest& request, std::string& error) {
+  std::stringstream ss(text);
+  std::string pair;
+  bool has_eye = false;
+  Vec3f eye = {0.F};
+  Vec3f at = {0.F, 0.F, 1.F};
+  Vec3f up = {0.F, 1.F, 0.F};
+
+  while (ss >> pair) {
+    const size_t equals = pair.find('=');
+    const std::string key = pair.substr(0, equals);
+    const std::string value = equals == std::string::npos ? "" : pair.substr(equals + 1);
+
+    bool ok = false;
+    try {
+      if (key == "scene") {
+        request.scene = value;
+        ok = !value.empty();
+      } else if (key == "width") {
+        ok = parse_size(value, request.width, kMaxImageSide);
+      } else if (key == "height") {
+        ok = parse_size(value, request.height, kMaxImageSide);
+      } else if (key == "spp") {
+        ok = parse_size(value, request.samples_per_pixel, kMaxSamplesPerPixel);
+      } else if (key == "bounces") {
+        ok = parse_size(value, request.max_ray_bounces, kMaxBounces);
+      } else if (key == "preview") {
+        request.integrator = value == "normals" ? IntegratorType::NORMALS
+                             : value == "depth" ? IntegratorType::DEPTH
+                             : value == "ao"    ? IntegratorType::AMBIENT_OCCLUSION
+                                                : IntegratorType::UNKNOWN;
+        ok = request.integrator != IntegratorType::UNKNOWN;
+      } else if (key == "pose") {
+        ok = parse_floats(value, request.pose_world_camera.data(), 6);
+      } else if (key == "eye") {
+        ok = has_eye = parse_floats(value, eye.data(), 3);
+      } else if (key == "at") {
+        ok = parse_floats(value, at.data(), 3);
+      } else if (key == "up") {
+        ok = parse_floats(value, up.data(), 3);
+      } else if (key == "exposure") {
+        size_t used = 0;
+        request.display.exposure = std::stof(value, &used);
+        ok = used == value.size() && std::abs(request.display.exposure) <= kMaxExposureStops;
+      } else if (key == "tonemap") {
+        ok = parse_tone_map(value, request.display.tone_map);
+      } else if (key == "transfer") {
+        request.display.transfer = value == "srgb" ? TransferFunction::SRGB : TransferFunction::GAMMA;
+        ok = value == "srgb" || value == "gamma";
+      }
+    } catch (const std::exception&) {
+      ok = false;
+    }
+
+    if (!ok) {
+      error = "bad or unknown parameter '" + pair + "'";
+      return false;
+    }
+  }
+
+  if (request.scene.empty()) {
+    error = "no scene given";
+    return false;
+  }
+  // the previews trace first hits only
+  const uint64_t bounces = request.integrator == IntegratorType::PATH ? request.max_ray_bounces : 1;
+  const uint64_t rays = uint64_t{request.width} * request.height * request.samples_per_pixel * bounces;
+  if (rays > kMaxRaysPerRequest) {
+    error = "request too large: " + std::to_string(rays) + " rays, at most " +
+            std::to_string(kMaxRaysPerRequest);
+    return false;
+  }
+  if (has_eye) request.pose_world_camera = LookAt(eye, at, up);
+  return true;
+}
+
+RenderServer::RenderServer(ThreadPool& pool, std::ostream& log)
+    : pool_(pool)
+    , log_(log) {}
+
+RenderServer::~RenderServer() { stop(); }
+
+void RenderServer::add_scene(const std::string& name, std::shared_ptr<const Hittable<float>> world,
+                             std::shared_ptr<const LightList<float>> lights) {
+  scenes_[name] = {std::move(world), std::move(lights)};
+}
+
+bool RenderServer::serve(const std::string& socket_path) {
+  sockaddr_un address;
+  if (!make_address(socket_path, address)) {
+    log_ << "Socket path too long: " << socket_path << "\n";
+    return false;
+  }
+
+  const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    log_ << "Failed to create socket: " << std::strerror(errno) << "\n";
+    return false;
+  }
+  ::unlink(socket_path.c_str());
+  if (::bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || ::listen(fd, 16) != 0) {
+    log_ << "Failed to listen on " << socket_path << ": " << std::strerror(errno) << "\n";
+    ::close(fd);
+    return false;
+  }
+  listen_fd_ = fd;
+  if (stopping_) {
+    stop();
+    return true;
+  }
+  log_ << "Serving " << scenes_.size() << " scene(s) on " << socket_path << " with " << pool_.size()
+       << " threads\n";
+
+  while (!stopping_) {
+    const int client = ::accept(fd, nullptr, nullptr);
+    if (client < 0) {
+      if (errno == EINTR) continue;
+      break;  // the listening socket was shut down by stop()
+    }
+
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+    if (stopping_) {
+      ::close(client);
+      break;
+    }
+    // detached, so finished connections don't pile up; stop() waits for the fds to drain instead
+    connection_fds_.insert(client);
+    std::thread([this, client] { handle_connection(client); }).detach();
+  }
+
+  ::unlink(socket_path.c_str());
+  return true;
+}
+
+void RenderServer::stop() {
+  stopping_ = true;
+  const int fd = listen_fd_.exchange(-1);
+  if (fd >= 0) {
+    ::shutdown(fd, SHUT_RDWR);
+    ::close(fd);
+  }
+
+  std::unique_lock<std::mutex> lock(connections_mutex_);
+  // unblocks clients waiting in recv; a job being rendered still finishes and is sent
+  for (const int client : connection_fds_) ::shutdown(client, SHUT_RD);
+  connections_done_.wait(lock, [this] { return connection_fds_.empty(); });
+}
+
+bool RenderServer::render(const RenderRequest& request, std::string& ppm, std::string& error) const {
+  const auto scene = scenes_.find(request.scene);
+  if (scene == scenes_.end()) {
+    error = "unknown scene '" + request.scene + "'";
+    return false;
+  }
+
+  const float width = static_cast<float>(request.width);
+  const float height = static_cast<float>(request.height);
+  const float parameters[5] = {width, width, width / 2.F, height / 2.F, 0.F};
+  const PinholeCamera<float> camera(width, height, parameters);
+
+  RenderSettings settings;
+  settings.samples_per_pixel = request.samples_per_pixel;
+  settings.max_ray_bounces = request.max_ray_bounces;
+  settings.integrator = request.integrator;
+  const Renderer<float> renderer(camera, request.pose_world_camera, *scene->second.world, *scene->second.lights,
+                                 pool_, settings);
+
+  Image accumulator = {request.width, request.height, PIXEL_FORMAT::RGB};
+  accumulator.alloc();
+  renderer.render_pass(accumulator, request.samples_per_pixel);
+  Image8 display;
+  post_process(accumulator, request.samples_per_pixel, request.display, display);
+
+  std::ostringstream out;
+  to_ppm(display, out);
+  ppm = out.str();
+  ++jobs_completed_;
+  return true;
+}
+
+void RenderServer::handle_connection(const int fd) {
+  std::string buffer;
+  std::string line;
+  while (!stopping_ && read_line(fd, buffer, line)) {
+    std::string payload;
+    const std::string status = handle_command(line, payload);
+    const std::string header = status.empty() ? "ok " + std::to_string(payload.size()) + "\n" : "error " + status + "\n";
+    if (!write_all(fd, header.data(), header.size())) break;
+    if (status.empty() && !write_all(fd, payload.data(), payload.size())) break;
+  }
+
+  std::lock_guard<std::mutex> lock(connections_mutex_);
+  connection_fds_.erase(fd);
+  ::close(fd);
+  connections_done_.notify_all();
+}
+
+// Returns an empty string on success, the error message otherwise.
+std::string RenderServer::handle_command(const std::string& line, std::string& payload) const {
+  std::stringstream ss(line);
+  std::string command;
+  ss >> command;
+
+  if (command == "scenes") {
+    for (const auto& scene : scenes_) payload.append(scene.first).append("\n");
+    return "";
+  }
+  if (command == "render") {
+    std::string rest;
+    std::getline(ss, rest);
+    RenderRequest request;
+    std::string error;
+    if (!parse_render_request(rest, request, error) || !render(request, payload, error)) return error;
+    return "";
+  }
+  return "unknown command '" + command + "'";
+}
+
+bool render_server_request(const std::string& socket_path, const std::string& command, std::string& payload,
+                           std::string& error) {
+  sockaddr_un address;
+  if (!make_address(socket_path, address)) {
+    error = "socket path too long";
+    return false;
+  }
+
+  const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || ::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+    error = std::string("failed to connect: ") + std::strerror(errno);
+    if (fd >= 0) ::close(fd);
+    return false;
+  }
+
+  const std::string line = command + "\n";
+  std::string buffer;
+  std::string header;
+  bool ok = write_all(fd, line.data(), line.size()) && read_line(fd, buffer, header);
+  if (!ok) {
+    error = "connection closed";
+  } else if (header.rfind("ok ", 0) == 0) {
+    ok = read_exactly(fd, buffer, std::stoull(header.substr(3)), payload);
+    if (!ok) error = "truncated reply";
+  } else {
+    error = header.rfind("error ", 0) == 0 ? header.substr(6) : header;
+    ok = false;
+  }
+
+  ::close(fd);
+  return ok;
+}
+
+}  // namespace rtow
@@ -0,0 +1,123 @@
+#include "rtow/simd.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+
+#define RTOW_SIMD_LANES 1
+#define RTOW_SIMD_NAMESPACE scalar
+#include "simd_kernels.h"
+
+namespace rtow {
+
+namespace {
+
+const SimdKernels& kernels_for(const SimdLevel level) {
+#if defined(__x86_64__) || defined(__i386__)
+  switch (level) {
+    case SimdLevel::AVX512:
+      return avx512::kKernels;
+    case SimdLevel::AVX2:
+      return avx2::kKernels;
+    case SimdLevel::SSE42:
+      return sse42::kKernels;
+    case SimdLevel::SCALAR:
+    default:
+      break;
+  }
+#endif
+  return scalar::kKernels;
+}
+
+std::atomic<int> g_level = -1;  // not chosen yet
+
+SimdLevel initial_level() {
+  const SimdLevel detected = detect_simd_level();
+  SimdLevel requested = detected;
+  if (const char* name = std::getenv("RTOW_SIMD")) {
+    if (!parse_simd_level(name, requested)) std::cerr << "Ignoring unknown RTOW_SIMD level '" << name << "'\n";
+  }
+  return std::min(requested, detected);
+}
+
+const SimdKernels& active() {
+  int level = g_level.load(std::memory_order_relaxed);
+  if (level < 0) {
+    int unset = -1;
+    const int chosen = static_cast<int>(initial_level());
+    level = g_level.compare_exchange_strong(unset, chosen) ? chosen : unset;
+  }
+  return kernels_for(static_cast<SimdLevel>(level));
+}
+
+}  // namespace
+
+const char* to_string(const SimdLevel level) {
+  switch (level) {
+    case SimdLevel::AVX512:
+      return "avx512";
+    case SimdLevel::AVX2:
+      return "avx2";
+    case SimdLevel::SSE42:
+      return "sse4.2";
+    case SimdLevel::SCALAR:
+    default:
+      return "scalar";
+  }
+}
+
+bool parse_simd_level(const std::string& name, SimdLevel& level) {
+  for (const SimdLevel l : {SimdLevel::SCALAR, SimdLevel::SSE42, SimdLevel::AVX2, SimdLevel::AVX512}) {
+    if (name == to_string(l)) {
+      level = l;
+      return true;
+    }
+  }
+  return false;
+}
+
+SimdLevel detect_simd_level() {
+#if defined(__x86_64__) || defined(__i386__)
+  // also checks that the OS saves the wider registers
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) return SimdLevel::AVX512;
+  if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+  if (__builtin_cpu_supports("sse4.2")) return SimdLevel::SSE42;
+#endif
+  return SimdLevel::SCALAR;
+}
+
+SimdLevel simd_level() {
+  active();
+  return static_cast<SimdLevel>(g_level.load());
+}
+
+SimdLevel set_simd_level(const SimdLevel level) {
+  const SimdLevel supported = std::min(level, detect_simd_level());
+  g_level = static_cast<int>(supported);
+  return supported;
+}
+
+size_t closest_sphere_hit(const SphereArrays& spheres, const float origin[3], const float direction[3],
+                          const float t_min, const float t_max, float& t) {
+  return active().closest_sphere_hit(spheres, origin, direction, t_min, t_max, &t);
+}
+
+bool any_sphere_hit(const SphereArrays& spheres, const float origin[3], const float direction[3], const float t_min,
+                    const float t_max) {
+  return active().any_sphere_hit(spheres, origin, direction, t_min, t_max);
+}
+
+void scale_and_gamma(const float* in, float* out, const size_t n, const float scale, const float exponent) {
+  active().scale_and_gamma(in, out, n, scale, exponent);
+}
+
+void quantize_unorm8(const float* in, uint8_t* out, const size_t n) { active().quantize_unorm8(in, out, n); }
+
+void tone_map_unorm8(const float* in, uint8_t* out, const size_t n, const float scale, const ToneMap op,
+                     const TransferFunction transfer, const float exponent) {
+  active().tone_map_unorm8(in, out, n, scale, op, transfer, exponent);
+}
+
+}  // namespace rtow
@@ -0,0 +1,11 @@
+// AVX2 build of the kernels in simd_kernels.h.
+#include <immintrin.h>
+
+#include "rtow/simd.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#pragma GCC target("avx2")
+#define RTOW_SIMD_LANES 8
+#define RTOW_SIMD_NAMESPACE avx2
+#include "simd_kernels.h"
+#endif
@@ -0,0 +1,274 @@
+// Kernel bodies shared by every instruction set. Each simd_<isa>.cpp includes this file once, after its
+// '#pragma GCC target', with RTOW_SIMD_LANES (floats per vector) and RTOW_SIMD_NAMESPACE defined, and
+// the kernels are compiled for that target only; simd.cpp builds the scalar version the same way.
+// Without RTOW_SIMD_NAMESPACE only the kernel table is declared.
+//
+// The kernels use GCC vector extensions, so the same source lowers to 1, 4, 8 or 16 lanes. They have
+// internal linkage, so the linker can't pick a copy compiled for a wider instruction set for use
+// elsewhere, and this file includes no system headers, whose inline functions would be compiled for
+// the target as well.
+
+#include "rtow/simd.h"
+
+#ifndef RTOW_SIMD_KERNEL_TABLE
+#define RTOW_SIMD_KERNEL_TABLE
+namespace rtow {
+
+/// One instruction set's build of every kernel.
+struct SimdKernels {
+  size_t (*closest_sphere_hit)(const SphereArrays&, const float*, const float*, float, float, float*);
+  bool (*any_sphere_hit)(const SphereArrays&, const float*, const float*, float, float);
+  void (*scale_and_gamma)(const float*, float*, size_t, float, float);
+  void (*quantize_unorm8)(const float*, uint8_t*, size_t);
+  void (*tone_map_unorm8)(const float*, uint8_t*, size_t, float, ToneMap, TransferFunction, float);
+};
+
+namespace scalar { extern const SimdKernels kKernels; }
+namespace sse42 { extern const SimdKernels kKernels; }
+namespace avx2 { extern const SimdKernels kKernels; }
+namespace avx512 { extern const SimdKernels kKernels; }
+
+}  // namespace rtow
+#endif
+
+#ifdef RTOW_SIMD_NAMESPACE
+namespace rtow::RTOW_SIMD_NAMESPACE {
+namespace {
+
+constexpr size_t kLanes = RTOW_SIMD_LANES;
+typedef float vf __attribute__((vector_size(kLanes * sizeof(float))));
+typedef int32_t vi __attribute__((vector_size(kLanes * sizeof(int32_t))));
+
+inline vf splat(const float x) { return vf{} + x; }
+inline vi splat(const int32_t x) { return vi{} + x; }
+
+inline vf load(const float* p) {
+  vf v;
+  __builtin_memcpy(&v, p, sizeof(vf));
+  return v;
+}
+
+inline void store(float* p, const vf v) { __builtin_memcpy(p, &v, sizeof(vf)); }
+
+// lanes [0, count) from 'p', the rest 'fill'
+inline vf load_partial(const float* p, const size_t count, const float fill) {
+  vf v = splat(fill);
+  for (size_t l = 0; l < count; ++l) v[l] = p[l];
+  return v;
+}
+
+inline vi lane_index() {
+  vi v;
+  for (size_t l = 0; l < kLanes; ++l) v[l] = static_cast<int32_t>(l);
+  return v;
+}
+
+inline vf vsqrt(const vf x) {
+#if RTOW_SIMD_LANES == 16
+  // the masked form with x as the (unused) source: _mm512_sqrt_ps passes an undefined vector, which GCC
+  // reports as uninitialized
+  const auto v = reinterpret_cast<__m512>(x);
+  return reinterpret_cast<vf>(_mm512_mask_sqrt_ps(v, static_cast<__mmask16>(0xFFFF), v));
+#elif RTOW_SIMD_LANES == 8
+  return reinterpret_cast<vf>(_mm256_sqrt_ps(reinterpret_cast<__m256>(x)));
+#elif RTOW_SIMD_LANES == 4
+  return reinterpret_cast<vf>(_mm_sqrt_ps(reinterpret_cast<__m128>(x)));
+#else
+  return vf{__builtin_sqrtf(x[0])};
+#endif
+}
+
+inline vf vmin(const vf a, const vf b) { return a < b ? a : b; }
+inline vf vmax(const vf a, const vf b) { return a > b ? a : b; }
+
+inline bool any(const vi mask) {
+  int32_t bits = 0;
+  for (size_t l = 0; l < kLanes; ++l) bits |= mask[l];
+  return bits != 0;
+}
+
+// Per-lane ray/sphere test for spheres [i, i + kLanes); the same operations, in the same order, as
+// SceneArena's scalar loop. Lanes without a hit in [t_min, t_max] get +inf.
+inline vf sphere_roots(const SphereArrays& s, const size_t i, const float* o, const float* d, const float a,
+                       const float t_min, const float t_max) {
+  const size_t count = s.n - i < kLanes ? s.n - i : kLanes;
+  const vf cx = count == kLanes ? load(s.cx + i) : load_partial(s.cx + i, count, 0.F);
+  const vf cy = count == kLanes ? load(s.cy + i) : load_partial(s.cy + i, count, 0.F);
+  const vf cz = count == kLanes ? load(s.cz + i) : load_partial(s.cz + i, count, 0.F);
+  const vf r = count == kLanes ? load(s.r + i) : load_partial(s.r + i, count, 0.F);
+
+  const vf ox = o[0] - cx;
+  const vf oy = o[1] - cy;
+  const vf oz = o[2] - cz;
+  const vf b = 2.F * (ox * d[0] + oy * d[1] + oz * d[2]);
+  const vf c = ox * ox + oy * oy + oz * oz - r * r;
+  const vf discriminant = b * b - 4.F * a * c;
+
+  const vf sq = vsqrt(vmax(discriminant, splat(0.F)));
+  const vf near = (-b - sq) / (2.F * a);
+  const vf far = (-b + sq) / (2.F * a);
+  const vi near_ok = (near >= t_min) & (near <= t_max);
+  const vi far_ok = (far >= t_min) & (far <= t_max);
+  const vi valid = (discriminant >= 0.F) & (near_ok | far_ok) & (lane_index() < static_cast<int32_t>(count));
+
+  const vf inf = splat(__builtin_inff());
+  return valid ? (near_ok ? near : far) : inf;
+}
+
+size_t closest_sphere_hit(const SphereArrays& s, const float* o, const float* d, const float t_min,
+                          const float t_max, float* t) {
+  const float a = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+
+  vf best_t = splat(__builtin_inff());
+  vi best_i = splat(-1);
+  for (size_t i = 0; i < s.n; i += kLanes) {
+    const vf root = sphere_roots(s, i, o, d, a, t_min, t_max);
+    const vi closer = (root <= best_t) & (root != __builtin_inff());
+    best_t = closer ? root : best_t;
+    best_i = closer ? lane_index() + static_cast<int32_t>(i) : best_i;
+  }
+
+  size_t index = SIZE_MAX;
+  float closest = __builtin_inff();
+  for (size_t l = 0; l < kLanes; ++l) {
+    if (best_i[l] < 0) continue;
+    const size_t sphere = static_cast<size_t>(best_i[l]);
+    if (best_t[l] < closest || (best_t[l] == closest && sphere > index)) {
+      closest = best_t[l];
+      index = sphere;
+    }
+  }
+  *t = closest;
+  return index;
+}
+
+bool any_sphere_hit(const SphereArrays& s, const float* o, const float* d, const float t_min, const float t_max) {
+  const float a = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+  for (size_t i = 0; i < s.n; i += kLanes) {
+    if (any(sphere_roots(s, i, o, d, a, t_min, t_max) != __builtin_inff())) return true;
+  }
+  return false;
+}
+
+// x ^ e = 2 ^ (e * log2(x)) for x > 0
+inline vf pow_positive(const vf x_in, const float e) {
+  const vf x = vmin(vmax(x_in, splat(1e-30F)), splat(3.4e38F));
+
+  // log2(x) = exponent + log2(m), m in [1, 2); ln(m) = 2 atanh((m - 1) / (m + 1)), odd series to t^9
+  const vi bits = reinterpret_cast<vi>(x);
+  const vf exponent = __builtin_convertvector(((bits >> 23) & 255) - 127, vf);
+  const vf m = reinterpret_cast<vf>((bits & 0x7FFFFF) | 0x3F800000);
+  const vf u = (m - 1.F) / (m + 1.F);
+  const vf u2 = u * u;
+  const vf series = u * (2.F + u2 * (2.F / 3.F + u2 * (2.F / 5.F + u2 * (2.F / 7.F + u2 * (2.F / 9.F)))));
+  const vf y = vmin(vmax(e * (exponent + series * 1.44269504F), splat(-126.F)), splat(127.F));
+
+  // 2^y = 2^i * 2^f, i = floor(y), f in [0, 1); Taylor series of e^(f ln 2) to degree 7
+  vi i = __builtin_convertvector(y, vi);
+  i += reinterpret_cast<vi>(y < __builtin_convertvector(i, vf));  // truncation rounds negatives up
+  const vf f = (y - __builtin_convertvector(i, vf)) * 0.693147181F;
+  const vf p =
+      1.F + f * (1.F + f * (1.F / 2.F + f * (1.F / 6.F + f * (1.F / 24.F + f * (1.F / 120.F + f * (1.F / 720.F + f * (1.F / 5040.F)))))));
+  return p * reinterpret_cast<vf>((i + 127) << 23);
+}
+
+inline vf gamma_lanes(const vf in, const float scale, const float exponent) {
+  const vf x = in * scale;
+  return x > 0.F ? pow_positive(x, exponent) : splat(0.F);
+}
+
+void scale_and_gamma(const float* in, float* out, const size_t n, const float scale, const float exponent) {
+  size_t i = 0;
+  for (; i + kLanes <= n; i += kLanes) {
+    store(out + i, gamma_lanes(load(in + i), scale, exponent));
+  }
+  if (i < n) {
+    const vf v = gamma_lanes(load_partial(in + i, n - i, 0.F), scale, exponent);
+    for (size_t l = 0; i + l < n; ++l) out[i + l] = v[l];
+  }
+}
+
+inline vi quantize_lanes(const vf x) {
+  const vf clamped = x > 0.F ? vmin(x, splat(.9999F)) : splat(0.F);  // also maps NaN to 0
+  return __builtin_convertvector(clamped * 255.99F, vi);
+}
+
+void quantize_unorm8(const float* in, uint8_t* out, const size_t n) {
+  size_t i = 0;
+  for (; i + kLanes <= n; i += kLanes) {
+    const vi q = quantize_lanes(load(in + i));
+    for (size_t l = 0; l < kLanes; ++l) out[i + l] = static_cast<uint8_t>(q[l]);
+  }
+  if (i < n) {
+    const vi q = quantize_lanes(load_partial(in + i, n - i, 0.F));
+    for (size_t l = 0; i + l < n; ++l) out[i + l] = static_cast<uint8_t>(q[l]);
+  }
+}
+
+template <ToneMap kOperator, TransferFunction kTransfer>
+inline vi tone_map_lanes(const vf in, const float scale, const float exponent) {
+  // NaN and negative radiance to 0; the cap keeps the rational operators away from inf / inf
+  vf x = in * scale;
+  x = x > 0.F ? vmin(x, splat(1e6F)) : splat(0.F);
+
+  if constexpr (kOperator == ToneMap::REINHARD) {
+    x = x / (1.F + x);
+  } else if constexpr (kOperator == ToneMap::ACES) {
+    // Narkowicz's fit of the ACES filmic curve
+    x = (x * (2.51F * x + 0.03F)) / (x * (2.43F * x + 0.59F) + 0.14F);
+  }
+  x = vmin(x, splat(1.F));
+
+  vf encoded;
+  if constexpr (kTransfer == TransferFunction::SRGB) {
+    const vf curve = 1.055F * pow_positive(x, 1.F / 2.4F) - 0.055F;
+    encoded = x <= 0.0031308F ? 12.92F * x : curve;
+  } else {
+    encoded = x > 0.F ? pow_positive(x, exponent) : splat(0.F);
+  }
+  return quantize_lanes(encoded);
+}
+
+template <ToneMap kOperator, TransferFunction kTransfer>
+void tone_map_rows(const float* in, uint8_t* out, const size_t n, const float scale, const float exponent) {
+  size_t i = 0;
+  for (; i + kLanes <= n; i += kLanes) {
+    const vi q = tone_map_lanes<kOperator, kTransfer>(load(in + i), scale, exponent);
+    for (size_t l = 0; l < kLanes; ++l) out[i + l] = static_cast<uint8_t>(q[l]);
+  }
+  if (i < n) {
+    const vi q = tone_map_lanes<kOperator, kTransfer>(load_partial(in + i, n - i, 0.F), scale, exponent);
+    for (size_t l = 0; i + l < n; ++l) out[i + l] = static_cast<uint8_t>(q[l]);
+  }
+}
+
+template <ToneMap kOperator>
+void tone_map_rows(const float* in, uint8_t* out, const size_t n, const float scale, const TransferFunction transfer,
+                   const float exponent) {
+  if (transfer == TransferFunction::SRGB) {
+    tone_map_rows<kOperator, TransferFunction::SRGB>(in, out, n, scale, exponent);
+  } else {
+    tone_map_rows<kOperator, TransferFunction::GAMMA>(in, out, n, scale, exponent);
+  }
+}
+
+void tone_map_unorm8(const float* in, uint8_t* out, const size_t n, const float scale, const ToneMap op,
+                     const TransferFunction transfer, const float exponent) {
+  switch (op) {
+    case ToneMap::REINHARD:
+      return tone_map_rows<ToneMap::REINHARD>(in, out, n, scale, transfer, exponent);
+    case ToneMap::ACES:
+      return tone_map_rows<ToneMap::ACES>(in, out, n, scale, transfer, exponent);
+    case ToneMap::CLAMP:
+    default:
+      return tone_map_rows<ToneMap::CLAMP>(in, out, n, scale, transfer, exponent);
+  }
+}
+
+}  // namespace
+
+extern const SimdKernels kKernels = {&closest_sphere_hit, &any_sphere_hit, &scale_and_gamma, &quantize_unorm8,
+                                     &tone_map_unorm8};
+
+}  // namespace rtow::RTOW_SIMD_NAMESPACE
+#endif
@@ -0,0 +1,11 @@
+// SSE4.2 build of the kernels in simd_kernels.h.
+#include <immintrin.h>
+
+#include "rtow/simd.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#pragma GCC target("sse4.2")
+#define RTOW_SIMD_LANES 4
+#define RTOW_SIMD_NAMESPACE sse42
+#include "simd_kernels.h"
+#endif
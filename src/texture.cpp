@@ -0,0 +1,376 @@
+#include "rtow/texture.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "rtow/utils.hpp"
+
+namespace rtow {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x58545452U;  // "RTTX"
+constexpr uint32_t kVersion = 1U;
+constexpr size_t kMaxLevels = 32;
+constexpr size_t kTexels = MipTexture::kTileSize * MipTexture::kTileSize;
+constexpr size_t kTileBytes = kTexels * 3;
+
+struct FileHeader {
+  uint32_t magic = kMagic;
+  uint32_t version = kVersion;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t levels = 0;
+  uint32_t tile_size = MipTexture::kTileSize;
+  uint64_t fingerprint = 0;
+};
+
+struct FileLevel {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint64_t offset = 0;
+};
+
+size_t tiles(const size_t texels) { return (texels + MipTexture::kTileSize - 1) / MipTexture::kTileSize; }
+
+const std::array<float, 256>& srgb_to_linear() {
+  static const std::array<float, 256> table = [] {
+    std::array<float, 256> t{};
+    for (size_t i = 0; i < t.size(); ++i) {
+      const float c = static_cast<float>(i) / 255.F;
+      t[i] = c <= 0.04045F ? c / 12.92F : std::pow((c + 0.055F) / 1.055F, 2.4F);
+    }
+    return t;
+  }();
+  return table;
+}
+
+uint8_t linear_to_srgb(const float linear) {
+  const float c = std::clamp(linear, 0.F, 1.F);
+  const float encoded = c <= 0.0031308F ? c * 12.92F : 1.055F * std::pow(c, 1.F / 2.4F) - 0.055F;
+  return static_cast<uint8_t>(encoded * 255.F + 0.5F);
+}
+
+/// Set-associative cache of tiles decoded to linear color, one per thread. Small enough to stay in L2;
+/// keys pack the texture id, level and tile coordinates.
+class DecodedTileCache {
+public:
+  static constexpr size_t kSets = 16;
+  static constexpr size_t kWays = 4;
+  static constexpr uint64_t kEmpty = UINT64_MAX;
+
+  DecodedTileCache();
+  ~DecodedTileCache();
+
+  const color* find(const uint64_t key) {
+    const size_t set = mix64(key) % kSets;
+    for (size_t way = 0; way < kWays; ++way) {
+      if (keys_[set][way] == key) {
+        hits.store(hits.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return tiles_[set * kWays + way].data();
+      }
+    }
+    misses.store(misses.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return nullptr;
+  }
+
+  /// Slot for 'key', evicting the set's entries round-robin.
+  color* insert(const uint64_t key) {
+    const size_t set = mix64(key) % kSets;
+    const size_t way = next_[set]++ % kWays;
+    keys_[set][way] = key;
+    return tiles_[set * kWays + way].data();
+  }
+
+  // written only by the owning thread, read by texture_cache_stats
+  std::atomic<size_t> hits = 0;
+  std::atomic<size_t> misses = 0;
+
+private:
+  std::array<std::array<uint64_t, kWays>, kSets> keys_;
+  std::array<size_t, kSets> next_{};
+  std::vector<std::array<color, kTexels>> tiles_;
+};
+
+struct CacheRegistry {
+  std::mutex mutex;
+  std::vector<DecodedTileCache*> caches;
+  TextureCacheStats retired;  // of threads that have exited
+  TextureCacheStats baseline;  // totals at the last reset
+};
+
+CacheRegistry& registry() {
+  static CacheRegistry r;
+  return r;
+}
+
+DecodedTileCache::DecodedTileCache()
+    : tiles_(kSets * kWays) {
+  for (auto& set : keys_) {
+    set.fill(kEmpty);
+  }
+  CacheRegistry& r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  r.caches.push_back(this);
+}
+
+DecodedTileCache::~DecodedTileCache() {
+  CacheRegistry& r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  r.caches.erase(std::find(r.caches.begin(), r.caches.end(), this));
+  r.retired.hits += hits.load();
+  r.retired.misses += misses.load();
+}
+
+thread_local DecodedTileCache t_cache;
+
+TextureCacheStats totals(const CacheRegistry& r) {
+  TextureCacheStats stats = r.retired;
+  for (const DecodedTileCache* cache : r.caches) {
+    stats.hits += cache->hits.load(std::memory_order_relaxed);
+    stats.misses += cache->misses.load(std::memory_order_relaxed);
+  }
+  return stats;
+}
+
+std::atomic<uint64_t> next_texture_id = 1;
+
+}  // namespace
+
+TextureCacheStats texture_cache_stats() {
+  CacheRegistry& r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  TextureCacheStats stats = totals(r);
+  stats.hits -= r.baseline.hits;
+  stats.misses -= r.baseline.misses;
+  return stats;
+}
+
+void reset_texture_cache_stats() {
+  CacheRegistry& r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  r.baseline = totals(r);
+}
+
+MipTexture::MipTexture(const uint8_t* rgb, const size_t width, const size_t height) {
+  if (width == 0 || height == 0) return;
+
+  // level sizes, halving (rounding down) until 1 x 1
+  std::vector<FileLevel> file_levels;
+  size_t offset = sizeof(FileHeader);
+  for (size_t w = width, h = height;; w = std::max<size_t>(w / 2, 1), h = std::max<size_t>(h / 2, 1)) {
+    file_levels.push_back({static_cast<uint32_t>(w), static_cast<uint32_t>(h), 0});
+    if (w == 1 && h == 1) break;
+  }
+  offset += file_levels.size() * sizeof(FileLevel);
+  for (FileLevel& level : file_levels) {
+    level.offset = offset;
+    offset += tiles(level.width) * tiles(level.height) * kTileBytes;
+  }
+  storage_.assign(offset, 0);
+
+  FileHeader header;
+  header.width = static_cast<uint32_t>(width);
+  header.height = static_cast<uint32_t>(height);
+  header.levels = static_cast<uint32_t>(file_levels.size());
+  header.fingerprint = hash_combine(hash_combine(kMagic, width), height);
+  for (size_t i = 0; i < width * height * 3; i += sizeof(uint64_t)) {
+    uint64_t word = 0;
+    std::memcpy(&word, rgb + i, std::min(sizeof(uint64_t), width * height * 3 - i));
+    header.fingerprint = hash_combine(header.fingerprint, word);
+  }
+  std::memcpy(storage_.data(), &header, sizeof(header));
+  std::memcpy(storage_.data() + sizeof(header), file_levels.data(), file_levels.size() * sizeof(FileLevel));
+
+  // each level is the 2 x 2 average of the one above in linear color; the linear values are carried
+  // down unquantized so rounding doesn't accumulate over levels
+  const auto& decode = srgb_to_linear();
+  std::vector<float> linear(width * height * 3);
+  for (size_t i = 0; i < linear.size(); ++i) {
+    linear[i] = decode[rgb[i]];
+  }
+  for (size_t l = 0; l < file_levels.size(); ++l) {
+    const size_t w = file_levels[l].width;
+    const size_t h = file_levels[l].height;
+    if (l > 0) {
+      const size_t pw = file_levels[l - 1].width;
+      const size_t ph = file_levels[l - 1].height;
+      std::vector<float> down(w * h * 3);
+      for (size_t y = 0; y < h; ++y) {
+        for (size_t x = 0; x < w; ++x) {
+          const size_t x0 = std::min(2 * x, pw - 1), x1 = std::min(2 * x + 1, pw - 1);
+          const size_t y0 = std::min(2 * y, ph - 1), y1 = std::min(2 * y + 1, ph - 1);
+          for (size_t c = 0; c < 3; ++c) {
+            down[(y * w + x) * 3 + c] = 0.25F * (linear[(y0 * pw + x0) * 3 + c] + linear[(y0 * pw + x1) * 3 + c] +
+                                                 linear[(y1 * pw + x0) * 3 + c] + linear[(y1 * pw + x1) * 3 + c]);
+          }
+        }
+      }
+      linear = std::move(down);
+    }
+
+    // tiles in row-major order, edge tiles padded by repeating the last row and column
+    uint8_t* out = storage_.data() + file_levels[l].offset;
+    for (size_t ty = 0; ty < tiles(h); ++ty) {
+      for (size_t tx = 0; tx < tiles(w); ++tx) {
+        for (size_t j = 0; j < kTileSize; ++j) {
+          for (size_t i = 0; i < kTileSize; ++i) {
+            const size_t x = std::min(tx * kTileSize + i, w - 1);
+            const size_t y = std::min(ty * kTileSize + j, h - 1);
+            for (size_t c = 0; c < 3; ++c) {
+              *out++ = l == 0 ? rgb[(y * w + x) * 3 + c] : linear_to_srgb(linear[(y * w + x) * 3 + c]);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  attach(storage_.data(), storage_.size());
+}
+
+MipTexture::~MipTexture() {
+  if (mapped_) munmap(const_cast<uint8_t*>(bytes_), size_);
+}
+
+std::shared_ptr<MipTexture> MipTexture::open(const std::string& path) {
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return nullptr;
+  struct stat st = {};
+  void* mapping = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    mapping = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  ::close(fd);  // the mapping stays valid
+  if (mapping == MAP_FAILED) return nullptr;
+
+  std::shared_ptr<MipTexture> texture(new MipTexture());
+  texture->mapped_ = true;
+  texture->bytes_ = static_cast<const uint8_t*>(mapping);
+  texture->size_ = static_cast<size_t>(st.st_size);
+  if (!texture->attach(texture->bytes_, texture->size_)) return nullptr;
+  return texture;
+}
+
+bool MipTexture::attach(const uint8_t* bytes, const size_t size) {
+  bytes_ = bytes;
+  size_ = size;
+  levels_.clear();
+
+  FileHeader header;
+  if (size < sizeof(header)) return false;
+  std::memcpy(&header, bytes, sizeof(header));
+  if (header.magic != kMagic || header.version != kVersion || header.tile_size != kTileSize || header.levels == 0 ||
+      header.levels > kMaxLevels || size < sizeof(header) + header.levels * sizeof(FileLevel)) {
+    return false;
+  }
+
+  size_t w = header.width;
+  size_t h = header.height;
+  for (size_t l = 0; l < header.levels; ++l) {
+    FileLevel level;
+    std::memcpy(&level, bytes + sizeof(header) + l * sizeof(FileLevel), sizeof(level));
+    const size_t tile_bytes = tiles(w) * tiles(h) * kTileBytes;
+    if (level.width != w || level.height != h || w == 0 || h == 0 || level.offset > size ||
+        size - level.offset < tile_bytes) {
+      levels_.clear();
+      return false;
+    }
+    levels_.push_back({w, h, tiles(w), static_cast<size_t>(level.offset)});
+    w = std::max<size_t>(w / 2, 1);
+    h = std::max<size_t>(h / 2, 1);
+  }
+
+  id_ = next_texture_id++;
+  return true;
+}
+
+bool MipTexture::save(const std::string& path) const {
+  if (levels_.empty()) return false;
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(reinterpret_cast<const char*>(bytes_), static_cast<std::streamsize>(size_));
+  return static_cast<bool>(out);
+}
+
+size_t MipTexture::width() const { return levels_.empty() ? 0 : levels_[0].width; }
+size_t MipTexture::height() const { return levels_.empty() ? 0 : levels_[0].height; }
+size_t MipTexture::levels() const { return levels_.size(); }
+
+uint64_t MipTexture::fingerprint() const {
+  if (levels_.empty()) return 0;
+  FileHeader header;
+  std::memcpy(&header, bytes_, sizeof(header));
+  return header.fingerprint;
+}
+
+color MipTexture::texel(const size_t level, const size_t x, const size_t y) const {
+  const Level& l = levels_[level];
+  const uint8_t* tile = bytes_ + l.offset + ((y / kTileSize) * l.tiles_u + x / kTileSize) * kTileBytes;
+  const uint8_t* p = tile + ((y % kTileSize) * kTileSize + x % kTileSize) * 3;
+  const auto& decode = srgb_to_linear();
+  return {decode[p[0]], decode[p[1]], decode[p[2]]};
+}
+
+const color* MipTexture::decoded_tile(const size_t level, const size_t tx, const size_t ty) const {
+  const uint64_t key = (id_ << 40U) | (static_cast<uint64_t>(level) << 32U) | (static_cast<uint64_t>(ty) << 16U) | tx;
+  if (const color* tile = t_cache.find(key)) return tile;
+
+  color* tile = t_cache.insert(key);
+  const Level& l = levels_[level];
+  const uint8_t* p = bytes_ + l.offset + (ty * l.tiles_u + tx) * kTileBytes;
+  const auto& decode = srgb_to_linear();
+  for (size_t i = 0; i < kTexels; ++i, p += 3) {
+    tile[i] = {decode[p[0]], decode[p[1]], decode[p[2]]};
+  }
+  return tile;
+}
+
+color MipTexture::bilinear(const size_t level, const float u, const float v) const {
+  const Level& l = levels_[level];
+  const auto w = static_cast<int64_t>(l.width);
+  const auto h = static_cast<int64_t>(l.height);
+  // texel centers sit at half-integers; wrap the parameters first so the coordinates stay small
+  const float x = (u - std::floor(u)) * static_cast<float>(w) - 0.5F;
+  const float y = (v - std::floor(v)) * static_cast<float>(h) - 0.5F;
+  const float fx = x - std::floor(x);
+  const float fy = y - std::floor(y);
+  const auto x0 = static_cast<int64_t>(std::floor(x));
+  const auto y0 = static_cast<int64_t>(std::floor(y));
+
+  color corners[4];
+  for (size_t k = 0; k < 4; ++k) {
+    const auto tx = static_cast<size_t>(((x0 + static_cast<int64_t>(k & 1U)) % w + w) % w);
+    const auto ty = static_cast<size_t>(((y0 + static_cast<int64_t>(k >> 1U)) % h + h) % h);
+    const color* tile = decoded_tile(level, tx / kTileSize, ty / kTileSize);
+    corners[k] = tile[(ty % kTileSize) * kTileSize + tx % kTileSize];
+  }
+  return (corners[0] * (1.F - fx) + corners[1] * fx) * (1.F - fy) + (corners[2] * (1.F - fx) + corners[3] * fx) * fy;
+}
+
+color MipTexture::value(float u, float v, const float width) const {
+  if (levels_.empty()) return color(0.F);
+  if (!std::isfinite(u)) u = 0.F;
+  if (!std::isfinite(v)) v = 0.F;
+
+  // level whose texels are as wide as the footprint
+  const auto size = static_cast<float>(std::max(levels_[0].width, levels_[0].height));
+  const float top = static_cast<float>(levels_.size() - 1);
+  const float lod = width > 0.F ? std::clamp(std::log2(width * size), 0.F, top) : 0.F;
+  const auto level = static_cast<size_t>(lod);
+  const float blend = lod - static_cast<float>(level);
+
+  const color fine = bilinear(level, u, v);
+  if (blend <= 0.F || level + 1 >= levels_.size()) return fine;
+  return fine * (1.F - blend) + bilinear(level + 1, u, v) * blend;
+}
+
+}  // namespace rtow
@@ -0,0 +1,145 @@
+#include "rtow/thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace rtow {
+
+namespace {
+
+thread_local size_t t_node = 0;
+
+}  // namespace
+
+struct ThreadPool::Job {
+  // the indices of one node, on their own cache line so nodes don't contend for the counters
+  struct alignas(64) Share {
+    std::atomic<size_t> next = 0;
+    size_t end = 0;
+  };
+
+  Job(const size_t n, const std::function<void(size_t)>& fn, const size_t num_nodes)
+      : n(n)
+      , fn(fn)
+      , shares(num_nodes) {
+    for (size_t k = 0; k < num_nodes; ++k) {
+      shares[k].next = k * n / num_nodes;
+      shares[k].end = (k + 1) * n / num_nodes;
+    }
+  }
+
+  size_t n = 0;
+  std::function<void(size_t)> fn;
+  std::vector<Share> shares;
+  std::atomic<size_t> done = 0;
+  std::mutex mutex;
+  std::condition_variable finished;
+};
+
+ThreadPool::ThreadPool(size_t num_threads)
+    : node_cpus_(1) {
+  // the submitting thread always takes part, so one fewer dedicated worker is needed
+  num_threads = std::max<size_t>(num_threads, 1);
+  for (size_t i = 0; i + 1 < num_threads; ++i) {
+    workers_.emplace_back([this] { worker_loop(0); });
+  }
+}
+
+ThreadPool::ThreadPool(size_t num_threads, const NumaTopology& topology)
+    : node_cpus_(topology.node_cpus) {
+  // with a single node there is nothing to keep local, and pinning would only stop the OS balancing load
+  if (node_cpus_.size() == 1) node_cpus_[0].clear();
+  num_threads = std::max<size_t>(num_threads, 1);
+  const size_t num_nodes = node_cpus_.size();
+  // thread t (0 being the submitting thread) goes to node t * nodes / threads, so nodes get equal shares
+  for (size_t t = 1; t < num_threads; ++t) {
+    const size_t node = t * num_nodes / num_threads;
+    workers_.emplace_back([this, node] {
+      pin_current_thread(node_cpus_[node]);  // unpinned threads still work on their node's share
+      worker_loop(node);
+    });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPool::parallel_for(size_t n, const std::function<void(size_t)>& fn) {
+  if (n == 0) return;
+
+  auto job = std::make_shared<Job>(n, fn, num_nodes());
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    jobs_.push_back(job);
+  }
+  cv_.notify_all();
+
+  run(*job);
+  retire(job);
+
+  std::unique_lock<std::mutex> lock(job->mutex);
+  job->finished.wait(lock, [&job] { return job->done.load() == job->n; });
+}
+
+size_t ThreadPool::current_node() { return t_node; }
+
+void ThreadPool::run_on_node(const size_t node, const std::function<void()>& fn) const {
+  if (node >= node_cpus_.size() || node_cpus_[node].empty()) {
+    fn();
+    return;
+  }
+  std::thread thread([&] {
+    pin_current_thread(node_cpus_[node]);
+    t_node = node;
+    fn();
+  });
+  thread.join();
+}
+
+void ThreadPool::worker_loop(const size_t node) {
+  t_node = node;
+  while (true) {
+    std::shared_ptr<Job> job;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+      if (jobs_.empty()) return;  // stopping
+      job = jobs_.front();
+    }
+
+    run(*job);
+    retire(job);
+  }
+}
+
+void ThreadPool::run(Job& job) {
+  // own node's share first, then help the other nodes in turn
+  const size_t num_shares = job.shares.size();
+  for (size_t s = 0; s < num_shares; ++s) {
+    Job::Share& share = job.shares[(t_node + s) % num_shares];
+    for (size_t i = share.next++; i < share.end; i = share.next++) {
+      job.fn(i);
+      if (++job.done == job.n) {
+        std::lock_guard<std::mutex> lock(job.mutex);
+        job.finished.notify_all();
+      }
+    }
+  }
+}
+
+void ThreadPool::retire(const std::shared_ptr<Job>& job) {
+  // every index has been claimed; stop handing the job out
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto it = std::find(jobs_.begin(), jobs_.end(), job);
+  if (it != jobs_.end()) jobs_.erase(it);
+}
+
+}  // namespace rtow
@@ -0,0 +1,97 @@
+#include "rtow/tile_cache.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace rtow {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x54575452U;  // "RTWT"
+constexpr uint32_t kVersion = 1U;
+
+struct Header {
+  uint32_t magic = kMagic;
+  uint32_t version = kVersion;
+  uint64_t key = 0;
+  uint32_t width = 0;
+  uint32_t height = 0;
+};
+
+}  // namespace
+
+TileCache::TileCache(const std::string& directory)
+    : directory_(directory) {
+  std::error_code error;
+  std::filesystem::create_directories(directory_, error);
+  if (error) std::cerr << "Failed to create tile cache directory " << directory_ << ": " << error.message() << "\n";
+}
+
+bool TileCache::load(const uint64_t key, Image& tile) {
+  std::ifstream in(path(key), std::ios_base::in | std::ios_base::binary);
+  Header header;
+  const size_t bytes = tile.width() * tile.height() * sizeof(color);
+  const bool hit = in && in.read(reinterpret_cast<char*>(&header), sizeof(header)) && header.magic == kMagic &&
+                   header.version == kVersion && header.key == key && header.width == tile.width() &&
+                   header.height == tile.height() &&
+                   in.read(reinterpret_cast<char*>(tile.data()), static_cast<std::streamsize>(bytes));
+  if (hit) {
+    ++hits_;
+    bytes_saved_ += bytes;
+  } else {
+    ++misses_;
+  }
+  return hit;
+}
+
+bool TileCache::store(const uint64_t key, const Image& tile) {
+  Header header;
+  header.key = key;
+  header.width = static_cast<uint32_t>(tile.width());
+  header.height = static_cast<uint32_t>(tile.height());
+  const size_t bytes = tile.width() * tile.height() * sizeof(color);
+
+  // write to a private file first and publish it with a rename
+  std::stringstream tmp;
+  tmp << path(key) << ".tmp" << std::this_thread::get_id();
+  {
+    std::ofstream out(tmp.str(), std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(tile.data()), static_cast<std::streamsize>(bytes));
+    if (!out) {
+      std::remove(tmp.str().c_str());
+      return false;
+    }
+  }
+  std::error_code error;
+  std::filesystem::rename(tmp.str(), path(key), error);
+  if (error) {
+    std::remove(tmp.str().c_str());
+    return false;
+  }
+
+  bytes_written_ += sizeof(header) + bytes;
+  return true;
+}
+
+TileCacheStats TileCache::stats() const {
+  return {hits_.load(), misses_.load(), bytes_saved_.load(), bytes_written_.load()};
+}
+
+void TileCache::reset_stats() {
+  hits_ = 0;
+  misses_ = 0;
+  bytes_saved_ = 0;
+  bytes_written_ = 0;
+}
+
+std::string TileCache::path(const uint64_t key) const {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.tile", static_cast<unsigned long long>(key));
+  return (std::filesystem::path(directory_) / name).string();
+}
+
+}  // namespace rtow
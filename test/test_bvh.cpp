@@ -0,0 +1,145 @@
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rtow/bvh.hpp"
+#include "rtow/material.hpp"
+#include "rtow/scene_arena.hpp"
+#include "rtow/utils.hpp"
+#include "test_util.hpp"
+
+// Checks the two-level BVH against brute force: a bottom level against its SceneArena, and a top level
+// against testing every instance, before and after moving some of them.
+
+using namespace rtow;
+using namespace rtow::test;
+
+namespace {
+
+struct Instance {
+  std::shared_ptr<const BottomLevelBvh<float>> object;
+  pose<float> pose_world_object;
+};
+
+// closest hit over all instances, without the top-level tree
+bool brute_force_hit(const std::vector<Instance>& instances, const Ray<float>& ray, HitRecord<float>& record) {
+  float closest = 1000.F;
+  bool hit = false;
+  for (const Instance& instance : instances) {
+    const RigidTransform<float> T_object_world = RigidTransform<float>(instance.pose_world_object).inverse();
+    const Ray<float> ray_object = {T_object_world.transform_point(ray.origin()),
+                                   T_object_world.transform_dir(ray.direction())};
+    if (instance.object->hit(ray_object, 0.001F, closest, record)) {
+      closest = record.t;
+      hit = true;
+    }
+  }
+  if (hit) record.t = closest;
+  return hit;
+}
+
+pose<float> random_pose(const float spread) {
+  return {{random(-spread, spread), random(-spread, spread), random(-spread, spread), random(-3.F, 3.F),
+           random(-1.5F, 1.5F), random(-3.F, 3.F)}};
+}
+
+Ray<float> random_ray() {
+  return {Vec3f{random(-30.F, 30.F), random(-30.F, 30.F), -40.F},
+          Vec3f{random(-0.5F, 0.5F), random(-0.5F, 0.5F), 1.F}};
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  seed_random(3);
+  auto material = std::make_shared<Lambertian<float>>(color{0.5, 0.5, 0.5});
+
+  // bottom level against its arena
+  auto cloud = std::make_shared<SceneArena<float>>();
+  const auto m = cloud->add_material(material);
+  for (size_t i = 0; i < 500; ++i) {
+    cloud->add_sphere(Vec3f{random(-3.F, 3.F), random(-3.F, 3.F), random(-3.F, 3.F)}, random(0.05F, 0.3F), m);
+  }
+  auto blob = std::make_shared<SceneArena<float>>();
+  const auto m2 = blob->add_material(material);
+  blob->add_sphere(Vec3f{0., 0., 0.}, 1., m2);
+  blob->add_sphere(Vec3f{1., 0., 0.}, 0.5, m2);
+
+  const auto cloud_bvh = std::make_shared<BottomLevelBvh<float>>(cloud);
+  const auto blob_bvh = std::make_shared<BottomLevelBvh<float>>(blob);
+
+  bool bottom_matches = true;
+  for (size_t i = 0; i < 2000; ++i) {
+    const Ray<float> ray = {Vec3f{random(-4.F, 4.F), random(-4.F, 4.F), -6.F},
+                            Vec3f{random(-0.5F, 0.5F), random(-0.5F, 0.5F), 1.F}};
+    HitRecord<float> expected;
+    HitRecord<float> actual;
+    const bool expected_hit = cloud->hit(ray, 0.001F, 1000.F, expected);
+    const bool actual_hit = cloud_bvh->hit(ray, 0.001F, 1000.F, actual);
+    bottom_matches &= expected_hit == actual_hit;
+    if (expected_hit && actual_hit) bottom_matches &= std::abs(expected.t - actual.t) <= 1e-5F * expected.t;
+    bottom_matches &= cloud->occluded(ray, 0.001F, 7.F) == cloud_bvh->occluded(ray, 0.001F, 7.F);
+  }
+  expect("bottom level matches its SceneArena", bottom_matches);
+
+  // top level against every instance
+  TopLevelBvh<float> scene;
+  std::vector<Instance> instances;
+  std::vector<InstanceHandle> handles;
+  for (size_t i = 0; i < 200; ++i) {
+    instances.push_back({i % 4 == 0 ? cloud_bvh : blob_bvh, random_pose(25.F)});
+    handles.push_back(scene.add(instances.back().object, instances.back().pose_world_object));
+  }
+  expect("first update builds the tree", scene.update().rebuilt);
+
+  const auto matches_brute_force = [&]() {
+    bool matches = true;
+    for (size_t i = 0; i < 1000; ++i) {
+      const Ray<float> ray = random_ray();
+      HitRecord<float> expected;
+      HitRecord<float> actual;
+      const bool expected_hit = brute_force_hit(instances, ray, expected);
+      const bool actual_hit = scene.hit(ray, 0.001F, 1000.F, actual);
+      matches &= expected_hit == actual_hit;
+      if (expected_hit && actual_hit) {
+        matches &= expected.t == actual.t && dot(actual.n, ray.direction()) <= 0.F &&
+                   std::abs((actual.p - ray.at(actual.t)).norm()) < 1e-4F;
+      }
+      matches &= expected_hit == scene.occluded(ray, 0.001F, 1000.F);
+    }
+    return matches;
+  };
+  expect("top level matches brute force", matches_brute_force());
+
+  // move a few instances: only their ancestors are refit
+  for (const size_t i : {3U, 77U, 150U}) {
+    instances[i].pose_world_object = random_pose(25.F);
+    scene.set_pose(handles[i], instances[i].pose_world_object);
+  }
+  const TopLevelUpdate update = scene.update();
+  size_t depth = 0;
+  for (size_t n = scene.bvh().nodes().size(); n > 1; n /= 2) ++depth;
+  std::cout << "moved " << update.moved << " instances, refit " << update.nodes_refit << " of "
+            << scene.bvh().nodes().size() << " nodes\n";
+  expect("moving 3 instances refits their paths to the root only",
+         !update.rebuilt && update.moved == 3 && update.nodes_refit <= 3 * (4 * depth + 1));
+  expect("top level matches brute force after the refit", matches_brute_force());
+
+  expect("an update without changes does nothing", scene.update().nodes_refit == 0);
+
+  // scrambling everything degrades the refit tree until it is rebuilt
+  bool rebuilt = false;
+  for (size_t round = 0; round < 4 && !rebuilt; ++round) {
+    for (size_t i = 0; i < instances.size(); ++i) {
+      instances[i].pose_world_object = random_pose(25.F);
+      scene.set_pose(handles[i], instances[i].pose_world_object);
+    }
+    rebuilt = scene.update().rebuilt;
+  }
+  expect("large motion triggers a rebuild", rebuilt);
+  expect("top level matches brute force after the rebuild", matches_brute_force());
+
+  return exit_code();
+}
@@ -0,0 +1,123 @@
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "rtow/image.h"
+#include "rtow/renderer.hpp"
+#include "rtow/thread_pool.h"
+#include "test_util.hpp"
+
+// Renders a small reference scene in several ways that must all agree bit for bit: on one thread and on
+// many, with different tile sizes, split into passes, and band by band.
+
+using namespace rtow;
+using namespace rtow::test;
+
+namespace {
+
+constexpr size_t kWidth = 32;
+constexpr size_t kHeight = 24;
+constexpr size_t kSpp = 4;
+
+// Hash of the reference render. Update it (and say why in the commit) whenever sampling or shading is
+// changed on purpose.
+constexpr uint64_t kReferenceHash = 0x87F600CE5EE34FA6ULL;
+
+// FNV-1a over the raw bytes of rows [v0, v1)
+uint64_t hash_rows(const Image& image, const size_t v0, const size_t v1) {
+  uint64_t hash = 0xCBF29CE484222325ULL;
+  for (size_t v = v0; v < v1; ++v) {
+    for (size_t u = 0; u < image.width(); ++u) {
+      unsigned char bytes[sizeof(color)];
+      std::memcpy(bytes, &image.at(u, v), sizeof(color));
+      for (const unsigned char b : bytes) {
+        hash = (hash ^ b) * 0x100000001B3ULL;
+      }
+    }
+  }
+  return hash;
+}
+
+uint64_t hash_image(const Image& image) { return hash_rows(image, 0, image.height()); }
+
+void check(const std::string& name, const uint64_t expected, const uint64_t actual) {
+  std::ostringstream label;
+  label << name << ": " << std::hex << actual;
+  expect(label.str(), expected == actual);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const PinholeCamera<> camera = make_test_camera(kWidth, kHeight);
+  const pose<> pose_world_camera = make_test_pose();
+  const TestScene scene = make_test_scene();
+  const SceneArena<float>& world = scene.world;
+  const LightList<float>& lights = scene.lights;
+
+  RenderSettings settings;
+  settings.samples_per_pixel = kSpp;
+  settings.max_ray_bounces = 8;
+
+  // reference: a single thread, all samples in one pass
+  ThreadPool serial(1);
+  Image reference = make_accumulator(kWidth, kHeight);
+  Renderer<float>(camera, pose_world_camera, world, lights, serial, settings).render_pass(reference, kSpp);
+  const uint64_t expected = hash_image(reference);
+  check("reference", kReferenceHash, expected);
+
+  ThreadPool parallel(4);
+  {
+    Image image = make_accumulator(kWidth, kHeight);
+    Renderer<float>(camera, pose_world_camera, world, lights, parallel, settings).render_pass(image, kSpp);
+    check("4 threads", expected, hash_image(image));
+  }
+  {
+    RenderSettings odd_tiles = settings;
+    odd_tiles.tile_size = 7;
+    Image image = make_accumulator(kWidth, kHeight);
+    Renderer<float>(camera, pose_world_camera, world, lights, parallel, odd_tiles).render_pass(image, kSpp);
+    check("7x7 tiles", expected, hash_image(image));
+  }
+  {
+    Image image = make_accumulator(kWidth, kHeight);
+    const Renderer<float> renderer(camera, pose_world_camera, world, lights, parallel, settings);
+    for (size_t k = 0; k < kSpp; ++k) {
+      renderer.render_pass(image, 1, 0, k);
+    }
+    check("one sample per pass", expected, hash_image(image));
+  }
+  {
+    // a deadline that is never reached leaves whole passes, one that has passed still gets the first
+    const Renderer<float> renderer(camera, pose_world_camera, world, lights, parallel, settings);
+    Image image = make_accumulator(kWidth, kHeight);
+    const size_t spp = renderer.render_until(image, Renderer<float>::Clock::time_point::max(), kSpp);
+    expect("render_until without time pressure", spp == kSpp && hash_image(image) == expected);
+
+    Image first = make_accumulator(kWidth, kHeight);
+    Image late = make_accumulator(kWidth, kHeight);
+    renderer.render_pass(first, 1);
+    const size_t late_spp = renderer.render_until(late, Renderer<float>::Clock::now());
+    expect("render_until past the deadline completes the first pass", late_spp == 1 && same_pixels(late, first));
+  }
+  {
+    // a band rendered on its own matches the same rows of the whole frame
+    const size_t v0 = 9;
+    const size_t rows = 5;
+    Image band = make_accumulator(kWidth, rows);
+    Renderer<float>(camera, pose_world_camera, world, lights, parallel, settings).render_pass(band, kSpp, v0);
+    check("band", hash_rows(reference, v0, v0 + rows), hash_image(band));
+  }
+  {
+    // a different seed must change the image
+    RenderSettings reseeded = settings;
+    reseeded.seed = 1;
+    Image image = make_accumulator(kWidth, kHeight);
+    Renderer<float>(camera, pose_world_camera, world, lights, parallel, reseeded).render_pass(image, kSpp);
+    expect("other seed differs", hash_image(image) != expected);
+  }
+
+  return exit_code();
+}
@@ -0,0 +1,221 @@
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "rtow/alias_table.h"
+#include "rtow/environment.hpp"
+#include "rtow/image.h"
+#include "rtow/integrator.hpp"
+#include "rtow/light.hpp"
+#include "rtow/material.hpp"
+#include "rtow/scene_arena.hpp"
+#include "rtow/utils.hpp"
+#include "test_util.hpp"
+
+// Checks the alias table and PFM reader, that the environment light's pdf is a density matching its
+// samples, that importance sampling a small sun estimates irradiance far better than cosine sampling, and
+// that a light list with a sky gives a direction the density of the light it meets only.
+
+using namespace rtow;
+using namespace rtow::test;
+
+namespace {
+
+constexpr size_t kWidth = 64;
+constexpr size_t kHeight = 32;
+constexpr float kSky = 0.2F;
+constexpr float kSun = 5000.F;
+
+bool same(const color& a, const color& b) { return a[0] == b[0] && a[1] == b[1] && a[2] == b[2]; }
+
+// dim uniform sky with a 2 x 2 texel sun, 45 degrees up
+Image sun_and_sky() {
+  Image image = {kWidth, kHeight, PIXEL_FORMAT::RGB};
+  image.alloc();
+  for (size_t v = 0; v < kHeight; ++v) {
+    for (size_t u = 0; u < kWidth; ++u) {
+      image.at(u, v) = color(kSky);
+    }
+  }
+  for (size_t v = 7; v < 9; ++v) {
+    for (size_t u = 20; u < 22; ++u) {
+      image.at(u, v) = color{kSun, kSun * 0.9F, kSun * 0.8F};
+    }
+  }
+  return image;
+}
+
+Vec3f direction(const double theta, const double phi) {
+  return Vec3f{static_cast<float>(std::sin(theta) * std::cos(phi)), static_cast<float>(-std::cos(theta)),
+               static_cast<float>(std::sin(theta) * std::sin(phi))};
+}
+
+}  // namespace
+
+int main() {
+  {
+    const AliasTable table({1., 2., 3., 0., 4., std::nan("")});
+    expect("alias table normalizes the weights", table.size() == 6 && std::abs(table.probability(2) - 0.3) < 1e-12 &&
+                                                     table.probability(3) == 0. && table.probability(5) == 0.);
+    // a regular grid over (u1, u2) hits every index in proportion to its probability
+    std::vector<size_t> counts(table.size(), 0);
+    constexpr size_t kSteps = 600;
+    for (size_t a = 0; a < kSteps; ++a) {
+      for (size_t b = 0; b < kSteps; ++b) {
+        ++counts[table.sample((a + 0.5) / kSteps, (b + 0.5) / kSteps)];
+      }
+    }
+    bool proportional = true;
+    for (size_t i = 0; i < table.size(); ++i) {
+      proportional = proportional &&
+                     std::abs(static_cast<double>(counts[i]) / (kSteps * kSteps) - table.probability(i)) < 0.005;
+    }
+    expect("alias table samples in proportion", proportional);
+    expect("all-zero weights give an empty table",
+           AliasTable({0., 0.}).empty() && AliasTable(std::vector<double>{}).empty());
+  }
+
+  const std::filesystem::path directory =
+      std::filesystem::temp_directory_path() / ("rtow_test_environment_" + std::to_string(getpid()));
+  std::filesystem::create_directories(directory);
+  {
+    const Image image = sun_and_sky();
+    const std::string path = (directory / "sky.pfm").string();
+    Image read = {0, 0, PIXEL_FORMAT::UNKNOWN};
+    expect("pfm round trip", write_pfm(path, image) && read_pfm(path, read) && same_pixels(read, image));
+
+    // 2 x 1 big-endian grey, bottom row first
+    const std::string grey_path = (directory / "grey.pfm").string();
+    {
+      std::ofstream out(grey_path, std::ios::binary);
+      out << "Pf\n2 1\n1.0\n";
+      const unsigned char values[] = {0x3F, 0x80, 0x00, 0x00, 0x40, 0x00, 0x00, 0x00};  // 1.0, 2.0
+      out.write(reinterpret_cast<const char*>(values), sizeof(values));
+    }
+    expect("grey big-endian pfm", read_pfm(grey_path, read) && read.width() == 2 && read.at(0, 0)[1] == 1.F &&
+                                      read.at(1, 0)[2] == 2.F);
+    expect("malformed pfm is rejected", !read_pfm((directory / "missing.pfm").string(), read));
+  }
+  std::filesystem::remove_all(directory);
+
+  const auto environment = std::make_shared<EnvironmentLight<float>>(sun_and_sky());
+  const Vec3f origin = {0., 0., 0.};
+  {
+    // midpoint rule over the sphere, much finer than the texels
+    double integral = 0.;
+    constexpr size_t kTheta = 512;
+    constexpr size_t kPhi = 1024;
+    for (size_t i = 0; i < kTheta; ++i) {
+      const double theta = M_PI * (i + 0.5) / kTheta;
+      for (size_t j = 0; j < kPhi; ++j) {
+        const double phi = 2. * M_PI * (j + 0.5) / kPhi - M_PI;
+        integral += environment->pdf(origin, direction(theta, phi)) * std::sin(theta) * (M_PI / kTheta) *
+                    (2. * M_PI / kPhi);
+      }
+    }
+    expect("pdf integrates to one over the sphere", std::abs(integral - 1.) < 1e-3);
+
+    seed_random(7);
+    size_t consistent = 0;
+    size_t towards_sun = 0;
+    constexpr size_t kSamples = 2000;
+    for (size_t i = 0; i < kSamples; ++i) {
+      LightSample<float> sample;
+      if (!environment->sample(origin, sample)) continue;
+      const float pdf = environment->pdf(origin, sample.direction);
+      const color radiance = environment->radiance(sample.direction);
+      consistent += std::abs(pdf - sample.pdf) <= 1e-3F * pdf && radiance[0] == sample.radiance[0] &&
+                    std::isinf(sample.distance);
+      towards_sun += sample.radiance[0] == kSun;
+    }
+    // texel edges may round either way
+    expect("samples carry their own pdf and radiance", consistent >= kSamples * 99 / 100);
+    expect("samples go where the light is", towards_sun > kSamples * 9 / 10);
+  }
+
+  {
+    // irradiance on a surface facing up (-y), exactly: every texel's radiance times its projected solid angle
+    const Vec3f up = {0., -1., 0.};
+    const Image image = sun_and_sky();
+    double reference = 0.;
+    for (size_t v = 0; v < kHeight; ++v) {
+      for (size_t u = 0; u < kWidth; ++u) {
+        constexpr size_t kSub = 8;
+        for (size_t a = 0; a < kSub; ++a) {
+          for (size_t b = 0; b < kSub; ++b) {
+            const double theta = M_PI * (v + (a + 0.5) / kSub) / kHeight;
+            const double cos_theta = std::cos(theta);
+            if (cos_theta <= 0.) continue;
+            reference += image.at(u, v)[0] * cos_theta * std::sin(theta) * (M_PI / (kHeight * kSub)) *
+                         (2. * M_PI / (kWidth * kSub));
+          }
+        }
+      }
+    }
+
+    constexpr size_t kTrials = 20;
+    constexpr size_t kSamples = 64;
+    double importance_error = 0.;
+    double cosine_error = 0.;
+    seed_random(11);
+    for (size_t trial = 0; trial < kTrials; ++trial) {
+      double importance = 0.;
+      double cosine = 0.;
+      for (size_t i = 0; i < kSamples; ++i) {
+        LightSample<float> sample;
+        if (environment->sample(origin, sample)) {
+          importance += sample.radiance[0] * std::max(0.F, dot(sample.direction, up)) / sample.pdf;
+        }
+        // cosine-weighted hemisphere: L cos / (cos / pi)
+        cosine += M_PI * environment->radiance(random_cosine_direction(up))[0];
+      }
+      importance_error += std::pow(importance / kSamples / reference - 1., 2.);
+      cosine_error += std::pow(cosine / kSamples / reference - 1., 2.);
+    }
+    importance_error = std::sqrt(importance_error / kTrials);
+    cosine_error = std::sqrt(cosine_error / kTrials);
+    std::cout << "  irradiance rms error at " << kSamples << " samples: importance " << importance_error * 100.
+              << "%, cosine " << cosine_error * 100. << "%\n";
+    expect("importance sampling converges", importance_error < 0.05);
+    expect("importance sampling beats cosine sampling by 10x", importance_error * 10. < cosine_error);
+  }
+
+  {
+    SceneArena<float> empty;
+    LightList<float> lights;
+    const Ray<float> ray = {Vec3f{0., 0., 0.}, Vec3f{0.3, -0.7, 0.2}};
+    const color sky = ray_color(ray, empty, lights, 4);
+    lights.set_environment(environment);
+    const color seen = ray_color(ray, empty, lights, 4);
+    expect("without an environment rays see the sky", same(sky, sky_color(ray)));
+    expect("with one they see its radiance", same(seen, environment->radiance(ray.direction())) && lights.size() == 1);
+    lights.set_environment(environment);
+    expect("setting it again replaces it", lights.size() == 1 && lights.environment() == environment.get());
+  }
+
+  {
+    // a lamp in front of the sky, in its own stratum: a direction through the lamp has the lamp's density
+    // where it meets the lamp and the sky's where it leaves the scene, never their sum
+    const auto lamp = std::make_shared<SphereLight<float>>(Vec3f{0., -2., 0.}, 0.5F,
+                                                           std::make_shared<DiffuseLight<float>>(color(5.F)));
+    LightList<float> lights;
+    lights.add(lamp);
+    lights.set_environment(environment);
+    lights.build_tree();
+    const Vec3f up = {0., -1., 0.};
+    const float sky_pdf = lights.pdf(origin, up, std::numeric_limits<float>::infinity());
+    const float lamp_pdf = lights.pdf(origin, up, 1.5F);
+    expect("a ray that leaves the scene only has the sky's density",
+           std::abs(sky_pdf - environment->pdf(origin, up) / 2.F) <= 1e-6F * sky_pdf);
+    expect("a ray that hits the lamp only has the lamp's density",
+           std::abs(lamp_pdf - lamp->pdf(origin, up) / 2.F) <= 1e-6F * lamp_pdf);
+  }
+
+  return exit_code();
+}
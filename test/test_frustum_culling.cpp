@@ -0,0 +1,104 @@
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "rtow/camera.hpp"
+#include "rtow/image.h"
+#include "rtow/light.hpp"
+#include "rtow/material.hpp"
+#include "rtow/pose.hpp"
+#include "rtow/renderer.hpp"
+#include "rtow/scene_arena.hpp"
+#include "rtow/thread_pool.h"
+#include "test_util.hpp"
+
+// Renders a wide field of spheres with and without per-tile frustum culling of the camera rays, checks
+// that the images are bit-identical, and that tiles see only a fraction of the scene.
+
+using namespace rtow;
+using namespace rtow::test;
+
+namespace {
+
+constexpr size_t kWidth = 64;
+constexpr size_t kHeight = 32;
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const PinholeCamera<> camera = make_test_camera(kWidth, kHeight, static_cast<float>(kWidth) / 2.F);
+  const pose<> pose_world_camera = LookAt(Vec3f{0., -2., -6.}, Vec3f{0., 0., 4.}, Vec3f{0., 1., 0.});
+
+  // a 24 x 24 field of small spheres on a ground sphere, plus a lamp
+  auto world = std::make_shared<SceneArena<float>>();
+  LightList<float> lights;
+  const auto ground = world->add_material(std::make_shared<Lambertian<float>>(color{0.5, 0.5, 0.5}));
+  const auto red = world->add_material(std::make_shared<Lambertian<float>>(color{0.7, 0.3, 0.3}));
+  const auto metal = world->add_material(std::make_shared<Metal<float>>(color{0.8, 0.6, 0.2}, 0.1));
+  const auto lamp_material = world->add_material(std::make_shared<DiffuseLight<float>>(color{40., 36., 30.}));
+  world->add_sphere(Vec3f{0., 1000.3, 0.}, 1000., ground);
+  for (int i = 0; i < 24; ++i) {
+    for (int j = 0; j < 24; ++j) {
+      world->add_sphere(Vec3f{-12.F + static_cast<float>(i), 0.F, -4.F + static_cast<float>(j)}, 0.3F,
+                        (i + j) % 3 == 0 ? metal : red);
+    }
+  }
+  const auto lamp = world->add_sphere(Vec3f{0., -4., 4.}, 0.5, lamp_material);
+  lights.add(std::make_shared<SphereLight<float>>(world->center(lamp), world->radius(lamp), world->material(lamp)));
+
+  ThreadPool pool(4);
+  for (const IntegratorType integrator :
+       {IntegratorType::PATH, IntegratorType::NORMALS, IntegratorType::DEPTH, IntegratorType::AMBIENT_OCCLUSION}) {
+    RenderSettings settings;
+    settings.max_ray_bounces = 4;
+    settings.integrator = integrator;
+    settings.tile_size = 8;
+
+    Image culled = make_accumulator(kWidth, kHeight);
+    Image full = make_accumulator(kWidth, kHeight);
+
+    settings.cull_tiles = true;
+    Renderer<float>(camera, pose_world_camera, *world, lights, pool, settings).render_pass(culled, 2);
+    settings.cull_tiles = false;
+    Renderer<float>(camera, pose_world_camera, *world, lights, pool, settings).render_pass(full, 2);
+    expect("integrator " + std::to_string(static_cast<int>(integrator)) + ": culled render is bit-identical",
+           same_pixels(culled, full));
+  }
+
+  // how much of the scene a tile keeps
+  RenderSettings settings;
+  settings.tile_size = 8;
+  Renderer<float> renderer(camera, pose_world_camera, *world, lights, pool, settings);
+  const long material_references = world->material({0}).use_count();
+  size_t kept = 0;
+  size_t tiles = 0;
+  for (size_t v0 = 0; v0 < kHeight; v0 += settings.tile_size) {
+    for (size_t u0 = 0; u0 < kWidth; u0 += settings.tile_size) {
+      const auto visible = std::dynamic_pointer_cast<const SceneArena<float>>(
+          renderer.tile_scene(u0, v0, u0 + settings.tile_size, v0 + settings.tile_size));
+      kept += visible ? visible->size() : world->size();
+      ++tiles;
+    }
+  }
+  const double fraction = static_cast<double>(kept) / static_cast<double>(tiles * world->size());
+  std::cout << "tiles keep " << fraction * 100. << "% of the primitives on average\n";
+  expect("tiles keep under a quarter of the scene", fraction < 0.25);
+  expect("tiles share the material table", world->material({0}).use_count() == material_references);
+
+  // tiles are culled once per pose; moving the camera must not reuse the old subsets
+  const auto first = renderer.tile_scene(0, 0, 8, 8);
+  expect("a tile is culled once and reused", first != nullptr && renderer.tile_scene(0, 0, 8, 8) == first);
+  Image before_move = make_accumulator(kWidth, kHeight);
+  renderer.render_pass(before_move, 1);
+  const pose<> moved = LookAt(Vec3f{3., -2., -3.}, Vec3f{0., 0., 2.}, Vec3f{0., 1., 0.});
+  renderer.set_pose(moved);
+  expect("moving the camera culls again", renderer.tile_scene(0, 0, 8, 8) != first);
+  Image culled = make_accumulator(kWidth, kHeight);
+  Image full = make_accumulator(kWidth, kHeight);
+  renderer.render_pass(culled, 1);
+  settings.cull_tiles = false;
+  Renderer<float>(camera, moved, *world, lights, pool, settings).render_pass(full, 1);
+  expect("after a move the culled render is bit-identical", same_pixels(culled, full));
+
+  return exit_code();
+}
@@ -0,0 +1,106 @@
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rtow/hittable.hpp"
+#include "rtow/material.hpp"
+#include "rtow/scene_arena.hpp"
+#include "rtow/sphere.hpp"
+#include "rtow/utils.hpp"
+#include "test_util.hpp"
+
+// Closest-hit queries find only (t, primitive) and finalize the winner. Checks that the attributes of the
+// finalized hit equal those computed eagerly for the closest sphere, for a list and for an arena.
+
+using namespace rtow;
+using namespace rtow::test;
+
+namespace {
+
+bool same_record(const HitRecord<float>& a, const HitRecord<float>& b) {
+  return a.t == b.t && a.front_face == b.front_face && a.material_ptr == b.material_ptr && a.p[0] == b.p[0] &&
+         a.p[1] == b.p[1] && a.p[2] == b.p[2] && a.n[0] == b.n[0] && a.n[1] == b.n[1] && a.n[2] == b.n[2];
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  seed_random(9);
+  std::vector<std::shared_ptr<Material<float>>> materials = {
+      std::make_shared<Lambertian<float>>(color{0.5, 0.5, 0.5}), std::make_shared<Metal<float>>(color{0.8, 0.6, 0.2}, 0.),
+      std::make_shared<Dielectric<float>>(1.5F)};
+
+  // heavily overlapping spheres, some hollow (negative radius), and a camera inside some of them
+  HittableList<float> list;
+  SceneArena<float> arena;
+  std::vector<std::shared_ptr<Sphere<float>>> spheres;
+  for (const auto& material : materials) arena.add_material(material);
+  for (size_t i = 0; i < 64; ++i) {
+    const Vec3f center = {random(-1.F, 1.F), random(-1.F, 1.F), random(1.F, 4.F)};
+    const float radius = random(0.3F, 1.2F) * (i % 7 == 0 ? -1.F : 1.F);
+    spheres.push_back(std::make_shared<Sphere<float>>(center, radius, materials[i % 3]));
+    list.add(spheres.back());
+    arena.add_sphere(center, radius, {static_cast<uint32_t>(i % 3)});
+  }
+
+  bool list_matches = true;
+  bool arena_matches = true;
+  size_t hits = 0;
+  for (size_t i = 0; i < 5000; ++i) {
+    const Ray<float> ray = {Vec3f{random(-0.5F, 0.5F), random(-0.5F, 0.5F), random(-1.F, 2.F)},
+                            Vec3f{random(-1.F, 1.F), random(-1.F, 1.F), random(-0.2F, 1.F)}};
+
+    // eager reference: full attributes for every sphere, keep the first of the closest
+    HitRecord<float> expected;
+    bool expected_hit = false;
+    for (const auto& sphere : spheres) {
+      HitRecord<float> candidate;
+      if (sphere->hit(ray, 0.001F, 1000.F, candidate) && (!expected_hit || candidate.t < expected.t)) {
+        expected = candidate;
+        expected_hit = true;
+      }
+    }
+    hits += expected_hit;
+
+    HitRecord<float> actual;
+    const bool list_hit = list.hit(ray, 0.001F, 1000.F, actual);
+    list_matches &= list_hit == expected_hit && (!list_hit || same_record(actual, expected));
+
+    PrimitiveHit<float> primitive_hit;
+    const bool arena_hit = arena.intersect(ray, 0.001F, 1000.F, primitive_hit);
+    arena_matches &= arena_hit == expected_hit;
+    if (arena_hit && expected_hit) {
+      // the vectorized arena rounds differently from Sphere
+      arena_matches &= primitive_hit.object == &arena &&
+                       std::abs(primitive_hit.t - expected.t) <= 1e-5F * (1.F + expected.t);
+      primitive_hit.object->finalize_hit(ray, primitive_hit, actual);
+      arena_matches &= actual.material_ptr == expected.material_ptr && actual.front_face == expected.front_face;
+    }
+  }
+  std::cout << hits << " of 5000 rays hit\n";
+  expect("list hits match eager attributes", list_matches);
+  expect("arena hits match eager attributes", arena_matches);
+
+  // a shared PrimitiveHit only ever moves closer
+  PrimitiveHit<float> shared;
+  const Ray<float> ray = {Vec3f{0., 0., -5.}, Vec3f{0., 0., 1.}};
+  const Sphere<float> near(Vec3f{0., 0., 0.}, 1., materials[0]);
+  const Sphere<float> far(Vec3f{0., 0., 3.}, 1., materials[1]);
+  const bool first = near.intersect(ray, 0.001F, 1000.F, shared);
+  const bool second = far.intersect(ray, 0.001F, 1000.F, shared);
+  expect("a farther hit leaves a shared PrimitiveHit alone", first && !second && shared.object == &near && shared.t == 4.F);
+
+  // spheres without a material still report hits
+  const Sphere<float> bare(Vec3f{0., 0., 0.}, 1., nullptr);
+  SceneArena<float> bare_arena;
+  bare_arena.add_sphere(Vec3f{0., 0., 0.}, 1., bare_arena.add_material(nullptr));
+  HitRecord<float> bare_record;
+  HitRecord<float> bare_arena_record;
+  expect("spheres without a material can be hit", bare.hit(ray, 0.001F, 1000.F, bare_record) &&
+                                                      bare_record.material_ptr == nullptr && bare_record.t == 4.F &&
+                                                      bare_arena.hit(ray, 0.001F, 1000.F, bare_arena_record) &&
+                                                      bare_arena_record.material_ptr == nullptr);
+
+  return exit_code();
+}
@@ -0,0 +1,233 @@
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rtow/environment.hpp"
+#include "rtow/image.h"
+#include "rtow/light.hpp"
+#include "rtow/material.hpp"
+#include "rtow/utils.hpp"
+#include "test_util.hpp"
+
+// Builds light trees over grids of small lamps and checks that their selection probabilities are a
+// distribution that sample() follows, that light lists using them keep sample and pdf consistent, that
+// they estimate lighting from many lamps far better than uniform selection, and that their cost grows
+// slowly with the number of lights.
+
+using namespace rtow;
+using namespace rtow::test;
+
+namespace {
+
+constexpr float kRadius = 0.05F;
+
+// 'side' x 'side' lamps of varying brightness one unit apart, hanging one unit above the ground (+y is down)
+std::vector<std::shared_ptr<Light<float>>> lamp_grid(const size_t side) {
+  std::vector<std::shared_ptr<Light<float>>> lamps;
+  for (size_t i = 0; i < side * side; ++i) {
+    const float emission = 1.F + static_cast<float>((i * 7919U) % 20U);
+    const Vec3f center = {static_cast<float>(i % side), -1.F, static_cast<float>(i / side)};
+    lamps.push_back(
+        std::make_shared<SphereLight<float>>(center, kRadius, std::make_shared<DiffuseLight<float>>(color(emission))));
+  }
+  return lamps;
+}
+
+LightList<float> light_list(const std::vector<std::shared_ptr<Light<float>>>& lamps, const bool tree) {
+  LightList<float> lights;
+  for (const auto& lamp : lamps) lights.add(lamp);
+  if (tree) lights.build_tree();
+  return lights;
+}
+
+std::vector<uint32_t> all(const size_t n) {
+  std::vector<uint32_t> indices(n);
+  for (size_t i = 0; i < n; ++i) indices[i] = static_cast<uint32_t>(i);
+  return indices;
+}
+
+}  // namespace
+
+int main() {
+  const auto lamps = lamp_grid(32);
+  LightTree<float> tree;
+  tree.build(lamps, all(lamps.size()));
+  expect("every lamp is in the tree", tree.size() == lamps.size());
+
+  {
+    bool sums_to_one = true;
+    for (const Vec3f p : {Vec3f{0., 0., 0.}, Vec3f{15.5, -0.5, 15.5}, Vec3f{40., -10., -5.}, Vec3f{3., -1., 3.}}) {
+      double sum = 0.;
+      for (uint32_t i = 0; i < lamps.size(); ++i) sum += tree.probability(p, i);
+      sums_to_one = sums_to_one && std::abs(sum - 1.) < 1e-4;
+    }
+    expect("selection probabilities sum to one", sums_to_one);
+
+    // evenly spaced numbers pick every lamp about as often as its probability says
+    const Vec3f p = {4.2F, 0.F, 7.7F};
+    std::vector<size_t> counts(lamps.size(), 0);
+    constexpr size_t kSamples = 200000;
+    bool pmf_matches = true;
+    for (size_t s = 0; s < kSamples; ++s) {
+      uint32_t light = 0;
+      float pmf = 0.F;
+      if (!tree.sample(p, (static_cast<float>(s) + 0.5F) / kSamples, light, pmf)) continue;
+      ++counts[light];
+      if (s % 100 == 0) {
+        const float probability = tree.probability(p, light);
+        pmf_matches = pmf_matches && std::abs(pmf - probability) <= 1e-4F * probability;
+      }
+    }
+    bool frequencies_match = true;
+    for (uint32_t i = 0; i < lamps.size(); ++i) {
+      frequencies_match =
+          frequencies_match && std::abs(static_cast<double>(counts[i]) / kSamples - tree.probability(p, i)) < 1e-3;
+    }
+    expect("sample reports the probability of its pick", pmf_matches);
+    expect("sample picks lamps as often as their probability", frequencies_match);
+    // lamps 260 (overhead) and 1020 (far away) are equally bright
+    expect("the lamp overhead is favoured",
+           tree.probability(p, 260) > 1.F / lamps.size() &&
+               tree.probability(p, 260) > 50.F * tree.probability(p, 1020));
+  }
+
+  {
+    // scalar irradiance (radiance over the sphere of directions) at a point near a corner, exactly: each
+    // lamp covers a cone of 2 pi (1 - cos) steradians
+    const Vec3f p = {1.3F, 0.F, 2.6F};
+    double reference = 0.;
+    for (uint32_t i = 0; i < lamps.size(); ++i) {
+      const float emission = 1.F + static_cast<float>((i * 7919U) % 20U);
+      const Vec3f center = {static_cast<float>(i % 32), -1.F, static_cast<float>(i / 32)};
+      const double d2 = (center - p).norm_squared();
+      reference += emission * 2. * M_PI * (1. - std::sqrt(1. - kRadius * kRadius / d2));
+    }
+
+    const LightList<float> uniform = light_list(lamps, false);
+    const LightList<float> with_tree = light_list(lamps, true);
+    const auto rms_error = [&](const LightList<float>& lights, const size_t samples, size_t& consistent) {
+      const size_t kTrials = 40;
+      double error = 0.;
+      for (size_t trial = 0; trial < kTrials; ++trial) {
+        double estimate = 0.;
+        for (size_t s = 0; s < samples; ++s) {
+          LightSample<float> sample;
+          if (!lights.sample(p, sample)) continue;
+          estimate += sample.radiance[0] / sample.pdf;
+          const float pdf = lights.pdf(p, sample.direction, sample.distance);
+          consistent += std::abs(pdf - sample.pdf) <= sample.pdf * 1e-3F;
+        }
+        error += std::pow(estimate / samples / reference - 1., 2.);
+      }
+      return std::sqrt(error / kTrials);
+    };
+    // directions at the edge of a far lamp's tiny cone may round to outside it and get no density
+    seed_random(3);
+    size_t consistent = 0;
+    const double uniform_error = rms_error(uniform, 64, consistent);
+    expect("uniform selection keeps sample and pdf consistent", consistent >= 40 * 64 * 99 / 100);
+    consistent = 0;
+    const double tree_error = rms_error(with_tree, 64, consistent);
+    expect("tree selection keeps sample and pdf consistent", consistent >= 40 * 64 * 99 / 100);
+    std::cout << "  rms error at 64 samples: uniform " << uniform_error * 100. << "%, tree " << tree_error * 100.
+              << "%\n";
+    expect("the tree estimates lighting from many lamps better", tree_error * 3. < uniform_error);
+
+    // the pdf only visits subtrees the direction enters, yet finds the lamp at the sample's distance
+    // among all lamps the direction passes (none, if the sample rounded to outside its lamp's cone)
+    bool matches = true;
+    for (size_t s = 0; s < 50; ++s) {
+      LightSample<float> sample;
+      if (!with_tree.sample(p, sample)) continue;
+      double brute_force = 0.;
+      for (uint32_t i = 0; i < lamps.size(); ++i) {
+        float distance = 0.F;
+        if (lamps[i]->distance(p, sample.direction, distance) &&
+            std::abs(distance - sample.distance) <= 1e-3F * sample.distance) {
+          brute_force += tree.probability(p, i) * lamps[i]->pdf(p, sample.direction);
+        }
+      }
+      const float pdf = with_tree.pdf(p, sample.direction, sample.distance);
+      matches = matches && std::abs(pdf - brute_force) <= 1e-3 * brute_force;
+    }
+    expect("the tree pdf is that of the lamp at the sample's distance", matches);
+  }
+
+  {
+    // one lamp: the tree draws the same numbers and gives the same samples as uniform selection
+    const auto one = lamp_grid(1);
+    const LightList<float> uniform = light_list(one, false);
+    const LightList<float> with_tree = light_list(one, true);
+    const Vec3f p = {0.3F, 0.F, 0.1F};
+    bool same = true;
+    for (size_t s = 0; s < 100; ++s) {
+      LightSample<float> a;
+      LightSample<float> b;
+      seed_random(s);
+      const bool sampled_a = uniform.sample(p, a);
+      seed_random(s);
+      const bool sampled_b = with_tree.sample(p, b);
+      same = same && sampled_a == sampled_b && a.pdf == b.pdf && a.direction[0] == b.direction[0] &&
+             a.direction[2] == b.direction[2] &&
+             uniform.pdf(p, a.direction, a.distance) == with_tree.pdf(p, a.direction, a.distance);
+    }
+    expect("a single lamp samples as before", same);
+  }
+
+  {
+    // lamps and a sky: each is picked half of the time
+    Image sky = {8, 4, PIXEL_FORMAT::RGB};
+    sky.alloc();
+    for (size_t v = 0; v < 4; ++v) {
+      for (size_t u = 0; u < 8; ++u) sky.at(u, v) = color(0.5F + static_cast<float>(v));
+    }
+    LightList<float> lights = light_list(lamps, false);
+    lights.set_environment(std::make_shared<EnvironmentLight<float>>(sky));
+    lights.build_tree();
+    seed_random(5);
+    const Vec3f p = {10.F, 0.F, 10.F};
+    size_t from_sky = 0;
+    size_t consistent = 0;
+    constexpr size_t kSamples = 4000;
+    for (size_t s = 0; s < kSamples; ++s) {
+      LightSample<float> sample;
+      if (!lights.sample(p, sample)) continue;
+      from_sky += std::isinf(sample.distance);
+      // the sky is everywhere, but only counts for directions that leave the scene, and lamps only where
+      // they are met
+      const float pdf = lights.pdf(p, sample.direction, sample.distance);
+      consistent += std::abs(pdf - sample.pdf) <= sample.pdf * 1e-3F;
+    }
+    expect("the sky is picked as often as the lamps", std::abs(static_cast<double>(from_sky) / kSamples - 0.5) < 0.03);
+    expect("sky and lamps keep sample and pdf consistent", consistent >= kSamples * 99 / 100);
+    lights.add(lamps.front());
+    expect("adding a light drops the tree", !lights.has_tree());
+  }
+
+  {
+    // picking a light and evaluating a pdf with 256 times more lights costs only a few times more
+    const auto time_per_query = [](const std::vector<std::shared_ptr<Light<float>>>& grid) {
+      const LightList<float> lights = light_list(grid, true);
+      seed_random(9);
+      constexpr size_t kQueries = 5000;
+      float checksum = 0.F;
+      const auto start = std::chrono::steady_clock::now();
+      for (size_t q = 0; q < kQueries; ++q) {
+        const Vec3f p = {random(0.F, 128.F), 0.F, random(0.F, 128.F)};
+        LightSample<float> sample;
+        if (lights.sample(p, sample)) checksum += lights.pdf(p, sample.direction, sample.distance);
+      }
+      const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      return checksum > 0.F ? elapsed / kQueries : 0.;
+    };
+    const double small = time_per_query(lamp_grid(8));
+    const double large = time_per_query(lamp_grid(128));
+    std::cout << "  per query: 64 lamps " << small * 1e9 << "ns, 16384 lamps " << large * 1e9 << "ns\n";
+    expect("cost grows slowly with the number of lights", large < small * 16.);
+  }
+
+  return exit_code();
+}
@@ -0,0 +1,105 @@
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "rtow/environment.hpp"
+#include "rtow/image.h"
+#include "rtow/integrator.hpp"
+#include "rtow/light.hpp"
+#include "rtow/material.hpp"
+#include "rtow/scene_arena.hpp"
+#include "rtow/utils.hpp"
+#include "test_util.hpp"
+
+// Estimates the direct lighting at a diffuse point under a lamp that hides most of a bigger lamp behind
+// it, and a sky, three ways: by sampling the lights only, by sampling the BSDF only, and by the path
+// tracer's multiple importance sampling of both. All three must agree, with uniform and with tree-based
+// light selection.
+
+using namespace rtow;
+using namespace rtow::test;
+
+namespace {
+
+constexpr size_t kSamples = 100000;
+
+struct Estimates {
+  double light = 0.;
+  double bsdf = 0.;
+  double mis = 0.;
+};
+
+Estimates estimate(const SceneArena<float>& world, const LightList<float>& lights) {
+  // grazes the top of the receiver, below both lamps, and hits it at the origin
+  const Ray<float> camera_ray = {Vec3f{4., -0.4, 0.}, normalize(Vec3f{-4., 0.4, 0.})};
+  HitRecord<float> record;
+  world.hit(camera_ray, kRayEpsilon<float>, kRayFar<float>, record);
+  const Material<float>& material = *record.material_ptr;
+
+  Estimates sums;
+  for (size_t s = 0; s < kSamples; ++s) {
+    LightSample<float> sample;
+    color f;
+    float pdf = 0.F;
+    if (lights.sample(record.p, sample) && material.eval(camera_ray, record, sample.direction, f, pdf) &&
+        !world.occluded({record.p, sample.direction}, kRayEpsilon<float>,
+                        sample.distance * (1.F - kRayEpsilon<float>))) {
+      sums.light += (f * sample.radiance)[0] / sample.pdf;
+    }
+
+    color attenuation;
+    Ray<float> ray_out;
+    if (material.scatter(camera_ray, record, attenuation, ray_out)) {
+      HitRecord<float> hit;
+      const color radiance = world.hit(ray_out, kRayEpsilon<float>, kRayFar<float>, hit)
+                                 ? hit.material_ptr->emitted(ray_out, hit)
+                                 : lights.environment()->radiance(ray_out.direction());
+      sums.bsdf += (attenuation * radiance)[0];
+    }
+
+    sums.mis += ray_color(camera_ray, world, lights, 2)[0];
+  }
+  return {sums.light / kSamples, sums.bsdf / kSamples, sums.mis / kSamples};
+}
+
+}  // namespace
+
+int main() {
+  SceneArena<float> world;
+  const auto receiver = world.add_material(std::make_shared<Lambertian<float>>(color(0.5F)));
+  const auto near_lamp = world.add_material(std::make_shared<DiffuseLight<float>>(color(4.F)));
+  const auto far_lamp = world.add_material(std::make_shared<DiffuseLight<float>>(color(2.F)));
+  world.add_sphere(Vec3f{0., 1., 0.}, 1., receiver);
+  // seen from the origin the near lamp covers 41.8 degrees around -y and the far one 47.9; the far one
+  // starts 3.1 away, past the near one's back
+  const auto near_sphere = world.add_sphere(Vec3f{0., -1.5, 0.}, 1., near_lamp);
+  const auto far_sphere = world.add_sphere(Vec3f{0., -12., 0.}, 8.9, far_lamp);
+
+  Image sky = {8, 4, PIXEL_FORMAT::RGB};
+  sky.alloc();
+  for (size_t v = 0; v < 4; ++v) {
+    for (size_t u = 0; u < 8; ++u) sky.at(u, v) = color(0.5F);
+  }
+
+  LightList<float> lights;
+  for (const auto sphere : {near_sphere, far_sphere}) {
+    lights.add(std::make_shared<SphereLight<float>>(world.center(sphere), world.radius(sphere),
+                                                    world.material(sphere)));
+  }
+  lights.set_environment(std::make_shared<EnvironmentLight<float>>(sky));
+
+  for (const bool tree : {false, true}) {
+    if (tree) lights.build_tree();
+    seed_random(tree ? 2 : 1);
+    const Estimates result = estimate(world, lights);
+    const std::string name = tree ? "tree selection" : "uniform selection";
+    std::cout << "  " << name << ": light sampling " << result.light << ", BSDF sampling " << result.bsdf
+              << ", MIS " << result.mis << "\n";
+    expect(name + ": light and BSDF sampling agree", std::abs(result.light / result.bsdf - 1.) < 0.02);
+    expect(name + ": MIS agrees with both", std::abs(result.mis / result.light - 1.) < 0.02 &&
+                                                std::abs(result.mis / result.bsdf - 1.) < 0.02);
+  }
+
+  return exit_code();
+}
@@ -0,0 +1,152 @@
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "rtow/hittable.hpp"
+#include "rtow/image.h"
+#include "rtow/material.hpp"
+#include "rtow/numa.h"
+#include "rtow/renderer.hpp"
+#include "rtow/sphere.hpp"
+#include "rtow/thread_pool.h"
+#include "test_util.hpp"
+
+// Checks topology parsing, and that a pool and renderer built for two NUMA nodes (a fake sysfs tree, so
+// it runs on single-node machines) work through the same indices and render the same pixels as the
+// plain ones.
+
+using namespace rtow;
+using namespace rtow::test;
+
+namespace {
+
+constexpr size_t kWidth = 40;
+constexpr size_t kHeight = 24;
+constexpr size_t kSpp = 2;
+
+Image render(ThreadPool& pool, const bool replicate, const SceneArena<float>& world, const LightList<float>& lights) {
+  const PinholeCamera<> camera = make_test_camera(kWidth, kHeight);
+  const pose<> pose_world_camera = make_test_pose();
+
+  RenderSettings settings;
+  settings.max_ray_bounces = 6;
+  settings.replicate_scene = replicate;
+  const Renderer<float> renderer(camera, pose_world_camera, world, lights, pool, settings);
+
+  Image accumulator = {kWidth, kHeight, PIXEL_FORMAT::RGB};
+  renderer.alloc(accumulator);
+  renderer.render_pass(accumulator, kSpp);
+  return accumulator;
+}
+
+}  // namespace
+
+int main() {
+  expect("cpu list with ranges", parse_cpu_list("0-3,8,10-11\n") == std::vector<size_t>{0, 1, 2, 3, 8, 10, 11});
+  expect("single cpu", parse_cpu_list("5") == std::vector<size_t>{5});
+  expect("malformed cpu lists are rejected", parse_cpu_list("3-1").empty() && parse_cpu_list("a").empty() &&
+                                                 parse_cpu_list("1,,2").empty());
+
+  const NumaTopology missing = NumaTopology::detect("/nonexistent/rtow/node");
+  expect("no sysfs: one node with every cpu",
+         missing.num_nodes() == 1 && missing.node_cpus[0].size() == std::max(std::thread::hardware_concurrency(), 1U));
+
+  const NumaTopology host = NumaTopology::detect();
+  bool nodes_have_cpus = host.num_nodes() >= 1;
+  for (const auto& cpus : host.node_cpus) {
+    nodes_have_cpus = nodes_have_cpus && !cpus.empty();
+  }
+  expect("host topology has at least one node, none empty", nodes_have_cpus);
+
+  // two nodes sharing cpu 0, which every machine has, listed out of order with a gap and a non-node entry
+  const std::filesystem::path sysfs =
+      std::filesystem::temp_directory_path() / ("rtow_test_numa_" + std::to_string(getpid()));
+  std::filesystem::remove_all(sysfs);
+  for (const char* node : {"node2", "node0"}) {
+    std::filesystem::create_directories(sysfs / node);
+    std::ofstream(sysfs / node / "cpulist") << "0\n";
+  }
+  std::filesystem::create_directories(sysfs / "power");
+  const NumaTopology fake = NumaTopology::detect(sysfs.string());
+  std::filesystem::remove_all(sysfs);
+  expect("fake sysfs: two nodes", fake.num_nodes() == 2 && fake.node_cpus[1] == std::vector<size_t>{0});
+
+  ThreadPool plain_pool(4);
+  ThreadPool numa_pool(4, fake);
+  ThreadPool single_node_pool(4, NumaTopology::single_node());
+  expect("node counts", plain_pool.num_nodes() == 1 && numa_pool.num_nodes() == 2 && single_node_pool.num_nodes() == 1);
+
+  {
+    constexpr size_t kIndices = 1000;
+    std::vector<std::atomic<int>> visits(kIndices);
+    std::atomic<size_t> on_node[2] = {0, 0};
+    numa_pool.parallel_for(kIndices, [&](const size_t i) {
+      ++visits[i];
+      ++on_node[ThreadPool::current_node()];
+      // hold every index until both nodes have taken one, or a single-cpu machine may let node 0's
+      // threads claim both shares before node 1's are scheduled
+      const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+      while ((on_node[0] == 0 || on_node[1] == 0) && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+      }
+    });
+    bool once = true;
+    for (const auto& count : visits) {
+      once = once && count == 1;
+    }
+    expect("numa pool: every index runs exactly once", once);
+    expect("numa pool: both nodes' threads take part", on_node[0] > 0 && on_node[1] > 0);
+
+    size_t node = SIZE_MAX;
+    numa_pool.run_on_node(1, [&] { node = ThreadPool::current_node(); });
+    expect("run_on_node runs on the node", node == 1 && ThreadPool::current_node() == 0);
+  }
+
+  const TestScene scene = make_test_scene();
+  const PinholeCamera<> camera = make_test_camera(kWidth, kHeight);
+  {
+    const Renderer<float> renderer(camera, make_test_pose(), scene.world, scene.lights, numa_pool);
+    Image image = {37, 21, PIXEL_FORMAT::RGB};
+    renderer.alloc(image);
+    bool zero = true;
+    for (size_t v = 0; v < image.height(); ++v) {
+      for (size_t u = 0; u < image.width(); ++u) {
+        zero = zero && image.at(u, v)[0] == 0.F && image.at(u, v)[1] == 0.F && image.at(u, v)[2] == 0.F;
+      }
+    }
+    expect("first-touch alloc zeroes every pixel", zero);
+  }
+
+  {
+    // a replica shares no geometry with the world, down to the children of a list
+    const auto material = std::make_shared<Lambertian<float>>(color{0.5, 0.5, 0.5});
+    const auto sphere = std::make_shared<Sphere<float>>(Vec3f{0., 0., 3.}, 1.F, material);
+    HittableList<float> list;
+    list.add(sphere);
+    RenderSettings settings;
+    settings.replicate_scene = true;
+    const Renderer<float> renderer(camera, make_test_pose(), list, scene.lights, numa_pool, settings);
+
+    const Hittable<float>* replica = nullptr;
+    numa_pool.run_on_node(1, [&] { replica = &renderer.scene(); });
+    PrimitiveHit<float> hit;
+    const bool hits = replica->intersect(Ray<float>(Vec3f{0.F}, Vec3f{0., 0., 1.}), 0.F, 10.F, hit);
+    expect("replicas are deep copies",
+           replica != &list && hits && hit.t == 2.F && hit.object != nullptr && hit.object != sphere.get());
+  }
+
+  const Image reference = render(plain_pool, false, scene.world, scene.lights);
+  const Image replicated = render(numa_pool, true, scene.world, scene.lights);
+  const Image single_node = render(single_node_pool, true, scene.world, scene.lights);
+  expect("numa pool with scene replicas renders the same pixels", same_pixels(reference, replicated));
+  expect("single-node topology renders the same pixels", same_pixels(reference, single_node));
+
+  return exit_code();
+}
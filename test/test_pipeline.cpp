@@ -0,0 +1,84 @@
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "rtow/image.h"
+#include "rtow/pipeline.hpp"
+#include "rtow/postprocess.h"
+#include "rtow/renderer.hpp"
+#include "rtow/streaming.hpp"
+#include "rtow/thread_pool.h"
+#include "test_util.hpp"
+
+// Renders frames through the overlapped render / post-process / encode / write pipeline, and as streamed
+// bands, and checks the output is byte-identical to render_pass followed by post_process and to_ppm.
+
+using namespace rtow;
+using namespace rtow::test;
+
+namespace {
+
+constexpr size_t kWidth = 50;  // not a multiple of the tile size, so edge tiles are partial
+constexpr size_t kHeight = 37;
+constexpr size_t kSpp = 2;
+
+std::string reference_ppm(const Renderer<float>& renderer, const PostProcessSettings& display) {
+  Image accumulator = make_accumulator(kWidth, kHeight);
+  renderer.render_pass(accumulator, kSpp);
+  Image8 pixels;
+  post_process(accumulator, kSpp, display, pixels);
+  std::ostringstream out;
+  to_ppm(pixels, out);
+  return std::move(out).str();
+}
+
+}  // namespace
+
+int main() {
+  const TestScene scene = make_test_scene();
+  const PinholeCamera<> camera = make_test_camera(kWidth, kHeight);
+  const pose<> pose_world_camera = make_test_pose();
+
+  ThreadPool pool(4);
+  RenderSettings settings;
+  settings.max_ray_bounces = 6;
+  const Renderer<float> renderer(camera, pose_world_camera, scene.world, scene.lights, pool, settings);
+
+  PostProcessSettings display;
+  {
+    std::ostringstream out;
+    const PipelineStats stats = render_pipelined(renderer, kWidth, kHeight, kSpp, display, out);
+    expect("default display: matches post_process + to_ppm", out.str() == reference_ppm(renderer, display));
+
+    const size_t tiles = ((kWidth + 15) / 16) * ((kHeight + 15) / 16);
+    expect("every tile is rendered and post-processed",
+           stats.render.items == tiles && stats.post_process.items == tiles);
+    expect("one encoded and written band per row of tiles",
+           stats.encode.items == (kHeight + 15) / 16 && stats.write.items == stats.encode.items);
+    expect("wall time covers rendering", stats.wall_ms >= stats.render_wall_ms && stats.drain_ms() >= 0.);
+    expect("whole frames cache one culled subset per tile", renderer.cached_tile_scenes() == tiles);
+  }
+
+  display.exposure = 1.F;
+  display.tone_map = ToneMap::ACES;
+  display.transfer = TransferFunction::SRGB;
+  {
+    // a single-slot queue blocks the renderer on every tile the post-process thread has not taken yet
+    std::ostringstream out;
+    render_pipelined(renderer, kWidth, kHeight, kSpp, display, out, 1);
+    expect("aces + srgb, queue depth 1: matches post_process + to_ppm",
+           out.str() == reference_ppm(renderer, display));
+  }
+  {
+    // a renderer of its own, so that nothing but the bands could have filled its tile cache
+    const Renderer<float> streamer(camera, pose_world_camera, scene.world, scene.lights, pool, settings);
+    std::ostringstream out;
+    const StreamingStats stats = render_streaming(streamer, kWidth, kHeight, 8, kSpp, display, out);
+    expect("streamed bands keep no culled tiles", streamer.cached_tile_scenes() == 0);
+    expect("aces + srgb, streamed bands: match post_process + to_ppm",
+           out.str() == reference_ppm(renderer, display) && stats.bands == (kHeight + 7) / 8);
+  }
+
+  return exit_code();
+}
@@ -0,0 +1,85 @@
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include "rtow/animation.hpp"
+#include "rtow/quaternion.hpp"
+#include "rtow/utils.hpp"
+#include "test_util.hpp"
+
+// Checks QuatTransform against the matrix forms of the Euler pose functions.
+
+using namespace rtow;
+using namespace rtow::test;
+
+namespace {
+
+template <size_t ROWS, size_t COLS>
+double max_difference(const Matrix<double, ROWS, COLS>& a, const Matrix<double, ROWS, COLS>& b) {
+  double difference = 0.;
+  for (size_t k = 0; k < ROWS * COLS; ++k) difference = std::max(difference, std::abs(a[k] - b[k]));
+  return difference;
+}
+
+pose<double> random_pose() {
+  return {{random(-5., 5.), random(-5., 5.), random(-5., 5.), random(-3., 3.), random(-1.5, 1.5), random(-3., 3.)}};
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  seed_random(5);
+
+  double euler = 0.;
+  double matrix = 0.;
+  double compose = 0.;
+  double inverse = 0.;
+  for (size_t i = 0; i < 200; ++i) {
+    const pose<double> ab = random_pose();
+    const pose<double> bc = random_pose();
+    const QuatTransform<double> T_ab(ab);
+    const QuatTransform<double> T_bc(bc);
+
+    euler = std::max(euler, max_difference(T_ab.to_matrix(), Pose2T(ab)));
+    matrix = std::max(matrix, max_difference(QuatTransform<double>(Pose2T(ab)).to_matrix(), Pose2T(ab)));
+    compose = std::max(compose, max_difference((T_ab * T_bc).to_matrix(), Pose2T(ab) * Pose2T(bc)));
+    inverse = std::max(inverse, max_difference((T_ab * T_ab.inverse()).to_matrix(), QuatTransform<double>().to_matrix()));
+  }
+  expect("from_euler matches Pose2T", euler < 1e-12);
+  expect("matrix round trip", matrix < 1e-12);
+  expect("composition matches the matrix product", compose < 1e-12);
+  expect("inverse", inverse < 1e-12);
+
+  // a long chain of small rolls at 90 degrees of pitch, where Euler angles lose a degree of freedom
+  const pose<double> start = {{0., 0., 0., 0.3, M_PI_2, 0.2}};
+  const pose<double> step = {{0.01, 0., 0., 0.001, 0., 0.}};
+  QuatTransform<double> chain(start);
+  Mat4<double> expected = Pose2T(start);
+  for (size_t i = 0; i < 1000; ++i) {
+    chain = chain * QuatTransform<double>(step);
+    expected = expected * Pose2T(step);
+  }
+  expect("long chains at gimbal lock stay accurate", max_difference(chain.to_matrix(), expected) < 1e-10);
+
+  // slerp: endpoints, and a constant rate about a single axis
+  const Quaternion<double> a = Quaternion<double>::from_euler(0., 0., 0.);
+  const Quaternion<double> b = Quaternion<double>::from_euler(0., 0., 2.);
+  const Quaternion<double> c = Quaternion<double>::from_euler(0., 0., 0.5);
+  bool slerp_ok = std::abs(slerp(a, b, 0.).dot(a)) > 1. - 1e-12 && std::abs(slerp(a, b, 1.).dot(b)) > 1. - 1e-12 &&
+                  std::abs(slerp(a, b, 0.25).dot(c)) > 1. - 1e-12;
+  // the shorter arc, for either sign of the same rotation
+  const Quaternion<double> minus_b = {-b.w, -b.x, -b.y, -b.z};
+  slerp_ok &= std::abs(slerp(a, minus_b, 0.25).dot(c)) > 1. - 1e-12;
+  expect("slerp", slerp_ok);
+
+  CameraPath<double> path;
+  const pose<double> first = random_pose();
+  const pose<double> last = random_pose();
+  path.add(0., first);
+  path.add(1., last);
+  expect("camera path ends on its keyframes", max_difference(Pose2T(path.at(0.)), Pose2T(first)) < 1e-12 &&
+                                                  max_difference(Pose2T(path.at(1.)), Pose2T(last)) < 1e-12 &&
+                                                  max_difference(Pose2T(path.frame(4, 5)), Pose2T(last)) < 1e-12);
+
+  return exit_code();
+}
@@ -0,0 +1,87 @@
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "rtow/render_server.h"
+#include "rtow/thread_pool.h"
+#include "test_util.hpp"
+
+// Serves a resident scene over a Unix socket to several concurrent clients and checks that every reply
+// matches an in-process render of the same request.
+
+using namespace rtow;
+using namespace rtow::test;
+
+int main(int argc, char** argv) {
+  const auto scene = std::make_shared<const TestScene>(make_test_scene());
+  const std::shared_ptr<const SceneArena<float>> world(scene, &scene->world);
+  const std::shared_ptr<const LightList<float>> lights(scene, &scene->lights);
+
+  ThreadPool pool(4);
+  RenderServer server(pool);
+  server.add_scene("test", world, lights);
+
+  const std::string socket_path = "/tmp/rtow_test_render_server_" + std::to_string(getpid()) + ".sock";
+  std::thread serving([&] { server.serve(socket_path); });
+  for (int attempt = 0; attempt < 100; ++attempt) {
+    std::string payload;
+    std::string error;
+    if (render_server_request(socket_path, "scenes", payload, error)) break;
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+
+  const std::vector<std::string> commands = {
+      "render scene=test width=40 height=30 spp=2 eye=0,-1.5,-1.8 at=0,0,1",
+      "render scene=test width=24 height=24 spp=3 eye=1,-1,-1 at=0,0,1 bounces=4",
+      "render scene=test width=32 height=16 spp=1 preview=normals",
+      "render scene=test width=40 height=30 spp=2 eye=0,-1.5,-1.8 at=0,0,1 "
+      "exposure=1 tonemap=aces transfer=srgb",
+  };
+
+  std::vector<std::string> replies(commands.size());
+  std::vector<int> ok(commands.size(), 0);
+  std::vector<std::thread> clients;
+  for (size_t i = 0; i < commands.size(); ++i) {
+    clients.emplace_back([&, i] {
+      std::string error;
+      ok[i] = render_server_request(socket_path, commands[i], replies[i], error);
+      if (!ok[i]) std::cout << "request " << i << " failed: " << error << "\n";
+    });
+  }
+  for (std::thread& client : clients) client.join();
+
+  for (size_t i = 0; i < commands.size(); ++i) {
+    RenderRequest request;
+    std::string expected;
+    std::string error;
+    const bool rendered = parse_render_request(commands[i].substr(7), request, error) &&
+                          server.render(request, expected, error);
+    expect("concurrent request " + std::to_string(i) + " matches an in-process render",
+           ok[i] && rendered && replies[i] == expected);
+  }
+
+  expect("the display transform applies to served images", replies[3] != replies[0]);
+
+  std::string payload;
+  std::string error;
+  expect("scene list", render_server_request(socket_path, "scenes", payload, error) && payload == "test\n");
+  expect("unknown scene is rejected",
+         !render_server_request(socket_path, "render scene=missing", payload, error) && !error.empty());
+  expect("bad parameter is rejected",
+         !render_server_request(socket_path, "render scene=test spp=-1", payload, error) && !error.empty());
+  expect("too many bounces are rejected",
+         !render_server_request(socket_path, "render scene=test bounces=65", payload, error) && !error.empty());
+  expect("too much total work is rejected",
+         !render_server_request(socket_path, "render scene=test width=8192 height=8192 spp=4096", payload, error) &&
+             error.find("too large") != std::string::npos);
+  expect("unknown tone map is rejected",
+         !render_server_request(socket_path, "render scene=test tonemap=filmic", payload, error) && !error.empty());
+
+  server.stop();
+  serving.join();
+  return exit_code();
+}
@@ -0,0 +1,88 @@
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "rtow/pose.hpp"
+#include "rtow/rigid_transform.hpp"
+#include "rtow/utils.hpp"
+#include "test_util.hpp"
+
+// Checks RigidTransform against the Euler pose functions it replaces on hot paths.
+
+using namespace rtow;
+using namespace rtow::test;
+
+namespace {
+
+bool near(const Vec3d& a, const Vec3d& b, const double tolerance = 1e-9) {
+  return std::abs(a[0] - b[0]) < tolerance && std::abs(a[1] - b[1]) < tolerance && std::abs(a[2] - b[2]) < tolerance;
+}
+
+pose<double> random_pose() {
+  // pitch away from +/-90 degrees, where the Euler angles are not unique
+  return {{random(-5., 5.), random(-5., 5.), random(-5., 5.), random(-3., 3.), random(-1.5, 1.5), random(-3., 3.)}};
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  seed_random(11);
+
+  bool points = true;
+  bool dirs = true;
+  bool inverse = true;
+  bool compose = true;
+  bool round_trip = true;
+  bool matrices = true;
+  for (size_t i = 0; i < 200; ++i) {
+    const pose<double> ab = random_pose();
+    const pose<double> bc = random_pose();
+    const RigidTransform<double> T_ab(ab);
+    const RigidTransform<double> T_bc(bc);
+    const Vec3d p = Vec3d::random(-10., 10.);
+
+    points &= near(T_ab.transform_point(p), Transform(ab, p));
+    dirs &= near(T_ab.transform_dir(p), TransformDir(ab, p)) && near(TransformDir(Pose2T(ab), p), TransformDir(ab, p));
+    inverse &= near(T_ab.inverse_transform_point(p), InvTransform(ab, p)) &&
+               near(T_ab.inverse().transform_point(T_ab.transform_point(p)), p) &&
+               near(InvTransform(Pose2T(ab), p), InvTransform(ab, p));
+    compose &= near((T_ab * T_bc).transform_point(p), Transform(TComp(ab, bc), p));
+
+    const pose<double> back = RigidTransform<double>(T_ab.to_matrix()).to_pose();
+    for (size_t k = 0; k < 6; ++k) round_trip &= std::abs(back[k] - ab[k]) < 1e-9;
+
+    const Mat4<double> expected = Pose2T(ab);
+    const Mat4<double> actual = T_ab.to_matrix();
+    for (size_t k = 0; k < 16; ++k) matrices &= std::abs(expected[k] - actual[k]) < 1e-12;
+  }
+  expect("points match Transform", points);
+  expect("directions match TransformDir", dirs);
+  expect("inverse matches InvTransform", inverse);
+  expect("composition matches TComp", compose);
+  expect("pose -> matrix -> pose round trip", round_trip);
+  expect("to_matrix matches Pose2T", matrices);
+
+  // batch transforms against single ones, in place
+  const RigidTransform<float> T(pose<float>{{1.F, -2.F, 3.F, 0.3F, -0.2F, 1.1F}});
+  std::vector<float> x, y, z;
+  for (size_t i = 0; i < 37; ++i) {
+    x.push_back(random(-5.F, 5.F));
+    y.push_back(random(-5.F, 5.F));
+    z.push_back(random(-5.F, 5.F));
+  }
+  std::vector<float> px = x, py = y, pz = z;
+  std::vector<float> dx(x.size()), dy(x.size()), dz(x.size());
+  T.transform_points(px.data(), py.data(), pz.data(), px.data(), py.data(), pz.data(), px.size());
+  T.transform_dirs(x.data(), y.data(), z.data(), dx.data(), dy.data(), dz.data(), x.size());
+  bool batch = true;
+  for (size_t i = 0; i < x.size(); ++i) {
+    const Vec3f p = T.transform_point({x[i], y[i], z[i]});
+    const Vec3f d = T.transform_dir({x[i], y[i], z[i]});
+    batch &= std::abs(p[0] - px[i]) < 1e-5F && std::abs(p[1] - py[i]) < 1e-5F && std::abs(p[2] - pz[i]) < 1e-5F;
+    batch &= std::abs(d[0] - dx[i]) < 1e-5F && std::abs(d[1] - dy[i]) < 1e-5F && std::abs(d[2] - dz[i]) < 1e-5F;
+  }
+  expect("batch transforms match single transforms", batch);
+
+  return exit_code();
+}
@@ -0,0 +1,155 @@
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "rtow/material.hpp"
+#include "rtow/postprocess.h"
+#include "rtow/scene_arena.hpp"
+#include "rtow/sphere.hpp"
+#include "rtow/texture.h"
+#include "test_util.hpp"
+
+// Builds mip-mapped textures, checks the levels and filtered lookups against direct averages, round-trips
+// the tiled file format, and checks that spheres with textured materials report uv and footprints.
+
+using namespace rtow;
+using namespace rtow::test;
+
+namespace {
+
+float srgb_to_linear(const uint8_t value) {
+  const float c = static_cast<float>(value) / 255.F;
+  return c <= 0.04045F ? c / 12.92F : std::pow((c + 0.055F) / 1.055F, 2.4F);
+}
+
+bool near(const color& a, const color& b, const float tolerance) {
+  return std::abs(a[0] - b[0]) <= tolerance && std::abs(a[1] - b[1]) <= tolerance && std::abs(a[2] - b[2]) <= tolerance;
+}
+
+// 'width' x 'height' pseudo-random pixels
+std::vector<uint8_t> noise(const size_t width, const size_t height) {
+  std::vector<uint8_t> rgb(width * height * 3);
+  uint32_t state = 12345U;
+  for (uint8_t& value : rgb) {
+    state = state * 1664525U + 1013904223U;
+    value = static_cast<uint8_t>(state >> 24U);
+  }
+  return rgb;
+}
+
+}  // namespace
+
+int main() {
+  const std::vector<uint8_t> rgb = noise(37, 20);
+  const MipTexture texture(rgb.data(), 37, 20);
+  expect("levels halve down to 1 x 1", texture.levels() == 6 && texture.width() == 37 && texture.height() == 20);
+
+  bool texels_exact = true;
+  for (size_t y = 0; y < 20; ++y) {
+    for (size_t x = 0; x < 37; ++x) {
+      const uint8_t* p = rgb.data() + (y * 37 + x) * 3;
+      texels_exact = texels_exact &&
+                     near(texture.texel(0, x, y), {srgb_to_linear(p[0]), srgb_to_linear(p[1]), srgb_to_linear(p[2])}, 0.F);
+    }
+  }
+  expect("level 0 holds the decoded pixels", texels_exact);
+
+  // level 1 texel (3, 2) averages level 0 texels (6..7, 4..5), up to the 8-bit encoding of the level
+  color average = {0.F};
+  for (size_t y = 4; y < 6; ++y) {
+    for (size_t x = 6; x < 8; ++x) {
+      average += texture.texel(0, x, y) * 0.25F;
+    }
+  }
+  expect("level 1 is the 2 x 2 linear average", near(texture.texel(1, 3, 2), average, 0.01F));
+
+  // texel centers sit at ((x + 0.5) / width, (y + 0.5) / height)
+  const color center = texture.value(5.5F / 37.F, 7.5F / 20.F, 0.F);
+  expect("unfiltered lookup at a texel center is the texel", near(center, texture.texel(0, 5, 7), 1e-5F));
+  const color wrapped = texture.value(5.5F / 37.F + 2.F, 7.5F / 20.F - 1.F, 0.F);
+  expect("lookups repeat in u and v", near(wrapped, center, 1e-4F));
+  const color coarsest = texture.value(0.3F, 0.6F, 100.F);
+  expect("a footprint wider than the texture reads the 1 x 1 level", near(coarsest, texture.texel(5, 0, 0), 1e-5F));
+  const color blended = texture.value(0.5F, 0.5F, std::sqrt(2.F) / 37.F);
+  expect("footprints between levels blend them",
+         std::isfinite(blended[0]) && !near(blended, texture.value(0.5F, 0.5F, 0.F), 0.F));
+
+  {
+    // a new texture has nothing cached yet
+    const MipTexture fresh(rgb.data(), 37, 20);
+    reset_texture_cache_stats();
+    for (size_t i = 0; i < 1000; ++i) {
+      fresh.value(0.25F, 0.25F, 0.F);
+    }
+    const TextureCacheStats stats = texture_cache_stats();
+    expect("repeated lookups hit the tile cache", stats.misses == 1 && stats.hits == 3999);
+    reset_texture_cache_stats();
+    expect("reset clears the stats", texture_cache_stats().hits == 0 && texture_cache_stats().misses == 0);
+  }
+
+  const std::filesystem::path directory =
+      std::filesystem::temp_directory_path() / ("rtow_test_texture_" + std::to_string(getpid()));
+  std::filesystem::create_directories(directory);
+  {
+    const std::string path = (directory / "noise.rtex").string();
+    expect("save", texture.save(path));
+    const std::shared_ptr<MipTexture> mapped = MipTexture::open(path);
+    expect("open maps the saved texture", mapped != nullptr && mapped->levels() == texture.levels());
+    bool same = mapped != nullptr && mapped->fingerprint() == texture.fingerprint();
+    for (size_t i = 0; same && i < 200; ++i) {
+      const float u = static_cast<float>(i) * 0.0137F;
+      const float v = static_cast<float>(i) * 0.0291F;
+      const float width = static_cast<float>(i % 7) * 0.01F;
+      same = near(mapped->value(u, v, width), texture.value(u, v, width), 0.F);
+    }
+    expect("mapped lookups match the in-memory texture", same);
+
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+    expect("truncated files are rejected", MipTexture::open(path) == nullptr);
+    expect("missing files are rejected", MipTexture::open((directory / "missing.rtex").string()) == nullptr);
+
+    const MipTexture other(noise(8, 8).data(), 8, 8);
+    expect("fingerprints tell contents apart", other.fingerprint() != texture.fingerprint());
+  }
+  {
+    const Image8 image = {37, 20, rgb};
+    const std::string path = (directory / "noise.ppm").string();
+    {
+      std::ofstream out(path);
+      to_ppm(image, out);
+    }
+    Image8 read;
+    expect("read_ppm reads what to_ppm wrote", read_ppm(path, read) && read.width == 37 && read.height == 20 && read.rgb == rgb);
+  }
+  std::filesystem::remove_all(directory);
+
+  {
+    const auto textured = std::make_shared<Lambertian<float>>(std::make_shared<MipTexture>(rgb.data(), 37, 20));
+    const auto plain = std::make_shared<Lambertian<float>>(color{0.7, 0.3, 0.3});
+    expect("only textured materials need uv", textured->needs_uv() && !plain->needs_uv());
+    expect("constant albedos keep their fingerprint", plain->fingerprint() == hash_combine_value(1U, color{0.7, 0.3, 0.3}));
+
+    // a one-pixel cone (spread 1/100) hitting the +x side of a unit sphere head on, 4 units away
+    const Ray<float> ray = {Vec3f{5., 0., 0.}, Vec3f{-1., 0., 0.}, 0.F, 0.01F};
+    HitRecord<float> record;
+    const Sphere<float> sphere(Vec3f{0., 0., 0.}, 1.F, textured);
+    expect("sphere hit reports uv", sphere.hit(ray, 0.001F, 100.F, record) && std::abs(record.uv[0] - 0.5F) < 1e-6F &&
+                                        std::abs(record.uv[1] - 0.5F) < 1e-6F);
+    expect("footprint is the cone width over the circumference",
+           std::abs(record.uv_width - 0.04F / (2.F * static_cast<float>(M_PI))) < 1e-6F);
+
+    SceneArena<float> arena;
+    arena.add_sphere(Vec3f{0., 0., 0.}, 1.F, arena.add_material(textured));
+    HitRecord<float> arena_record;
+    expect("arena hits report the same uv",
+           arena.hit(ray, 0.001F, 100.F, arena_record) && arena_record.uv[0] == record.uv[0] &&
+               arena_record.uv[1] == record.uv[1] && arena_record.uv_width == record.uv_width);
+  }
+
+  return exit_code();
+}
@@ -0,0 +1,90 @@
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unistd.h>
+
+#include "rtow/cached_render.hpp"
+#include "rtow/image.h"
+#include "rtow/renderer.hpp"
+#include "rtow/thread_pool.h"
+#include "rtow/tile_cache.h"
+#include "test_util.hpp"
+
+// Re-renders a scene through a tile cache after small edits and checks which tiles are reused, and that
+// cached frames match frames rendered from scratch.
+
+using namespace rtow;
+using namespace rtow::test;
+
+namespace {
+
+constexpr size_t kWidth = 48;
+constexpr size_t kHeight = 32;
+constexpr size_t kSpp = 2;
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const PinholeCamera<> camera = make_test_camera(kWidth, kHeight);
+  const pose<> pose_world_camera = make_test_pose();
+
+  const std::filesystem::path directory =
+      std::filesystem::temp_directory_path() / ("rtow_test_tile_cache_" + std::to_string(getpid()));
+  std::filesystem::remove_all(directory);
+  TileCache cache(directory.string());
+  ThreadPool pool(4);
+
+  const TestScene original = make_test_scene();
+  const TestScene moved = make_test_scene(-0.2F);  // the metal sphere on the right floats up a little
+
+  const auto render = [&](const TestScene& scene, const IntegratorType integrator, Image& reference) {
+    RenderSettings settings;
+    settings.max_ray_bounces = 6;
+    settings.integrator = integrator;
+    const Renderer<float> renderer(camera, pose_world_camera, scene.world, scene.lights, pool, settings);
+
+    cache.reset_stats();
+    Image image = make_accumulator(kWidth, kHeight);
+    reference = make_accumulator(kWidth, kHeight);
+    render_pass_cached(renderer, cache, image, kSpp);
+    renderer.render_pass(reference, kSpp);
+    return image;
+  };
+
+  {
+    Image reference = make_accumulator(kWidth, kHeight);
+    const Image first = render(original, IntegratorType::PATH, reference);
+    expect("path: cold cache misses every tile", cache.stats().hits == 0 && cache.stats().misses > 0);
+    expect("path: rendered tiles match render_pass", same_pixels(first, reference));
+
+    const Image second = render(original, IntegratorType::PATH, reference);
+    expect("path: warm cache hits every tile", cache.stats().misses == 0 && cache.stats().hits > 0);
+    expect("path: cached tiles match render_pass", same_pixels(second, reference));
+
+    render(moved, IntegratorType::PATH, reference);
+    expect("path: moving an object invalidates every tile", cache.stats().hits == 0);
+  }
+  {
+    Image reference = make_accumulator(kWidth, kHeight);
+    render(original, IntegratorType::NORMALS, reference);
+    const Image image = render(moved, IntegratorType::NORMALS, reference);
+    const TileCacheStats stats = cache.stats();
+    std::cout << "normals after the edit: " << stats.hits << " hits, " << stats.misses << " misses\n";
+    expect("normals: only tiles seeing the moved object are re-rendered", stats.hits > 0 && stats.misses > 0);
+    expect("normals: result matches render_pass", same_pixels(image, reference));
+  }
+  {
+    // spheres without a material are fingerprinted too
+    TestScene bare = make_test_scene();
+    bare.world.add_sphere(Vec3f{0.3, -0.3, 0.5}, 0.15, bare.world.add_material(nullptr));
+    Image reference = make_accumulator(kWidth, kHeight);
+    render(bare, IntegratorType::NORMALS, reference);
+    const Image image = render(bare, IntegratorType::NORMALS, reference);
+    expect("a sphere without a material: warm cache hits every tile", cache.stats().misses == 0);
+    expect("a sphere without a material: cached tiles match render_pass", same_pixels(image, reference));
+  }
+
+  std::filesystem::remove_all(directory);
+  return exit_code();
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "rtow/camera.hpp"
+#include "rtow/image.h"
+#include "rtow/light.hpp"
+#include "rtow/material.hpp"
+#include "rtow/pose.hpp"
+#include "rtow/scene_arena.hpp"
+
+// Shared by the tests: a pass/fail harness, and part10's spheres seen through a small pinhole camera.
+
+namespace rtow::test {
+
+inline int failures = 0;
+
+inline void expect(const std::string& name, const bool condition) {
+  std::cout << (condition ? "[ OK ] " : "[FAIL] ") << name << "\n";
+  failures += !condition;
+}
+
+/// Exit status of a test program: nonzero if any expectation failed.
+inline int exit_code() { return failures == 0 ? 0 : 1; }
+
+inline bool same_pixels(const Image& a, const Image& b) {
+  return a.width() == b.width() && a.height() == b.height() &&
+         std::memcmp(a.data(), b.data(), a.width() * a.height() * sizeof(color)) == 0;
+}
+
+/// Zeroed RGB image to accumulate samples into.
+inline Image make_accumulator(const size_t width, const size_t height) {
+  Image image = {width, height, PIXEL_FORMAT::RGB};
+  image.alloc();
+  return image;
+}
+
+/// Pinhole camera with the principal point at the image center; the focal length defaults to the width.
+inline PinholeCamera<> make_test_camera(const size_t width, const size_t height, const float focal = 0.F) {
+  Vec<float, 5> parameters(Vec<float, 5>::NaN);
+  parameters[0] = focal > 0.F ? focal : static_cast<float>(width);
+  parameters[1] = parameters[0];
+  parameters[2] = static_cast<float>(width) / 2.F;
+  parameters[3] = static_cast<float>(height) / 2.F;
+  parameters[4] = 0.F;
+  return PinholeCamera<>(static_cast<float>(width), static_cast<float>(height), parameters.data());
+}
+
+/// Looks at the spheres of make_test_scene from above and in front.
+inline pose<> make_test_pose() {
+  return LookAt(Vec3f{0., -1.5, -1.8}, Vec3f{0.02, -0.08, 0.}, Vec3f{0., 1., 0.});
+}
+
+struct TestScene {
+  SceneArena<float> world;
+  LightList<float> lights;
+};
+
+/// part10's scene: a ground sphere, a diffuse, a glass and a metal sphere, and a small lamp that is also
+/// the only explicit light. 'metal_y' moves the metal sphere on the right up (negative) or down.
+inline TestScene make_test_scene(const float metal_y = 0.F) {
+  TestScene scene;
+  SceneArena<float>& world = scene.world;
+  const auto ground = world.add_material(std::make_shared<Lambertian<float>>(color{0.5, 0.5, 0.0}));
+  const auto center = world.add_material(std::make_shared<Lambertian<float>>(color{0.7, 0.3, 0.3}));
+  const auto glass = world.add_material(std::make_shared<Dielectric<float>>(1.5F));
+  const auto metal = world.add_material(std::make_shared<Metal<float>>(color{0.8, 0.6, 0.2}, 0.0));
+  const auto lamp_material = world.add_material(std::make_shared<DiffuseLight<float>>(color{40., 36., 30.}));
+  world.add_sphere(Vec3f{0., 100.5, 1.}, 100., ground);
+  world.add_sphere(Vec3f{0., 0., 1.}, 0.5, center);
+  world.add_sphere(Vec3f{-1., 0., 1.}, 0.5, glass);
+  world.add_sphere(Vec3f{1., metal_y, 1.}, 0.5, metal);
+  const auto lamp = world.add_sphere(Vec3f{0.5, -1.2, 0.4}, 0.08, lamp_material);
+  scene.lights.add(
+      std::make_shared<SphereLight<float>>(world.center(lamp), world.radius(lamp), world.material(lamp)));
+  return scene;
+}
+
+}  // namespace rtow::test